@@ -0,0 +1,7 @@
+#include <Benchmark.hpp>
+
+// Runs the hardware-independent microbenchmarks and prints one JSON line per result
+int main() {
+    extcon::bench::Benchmark::runAll();
+    return 0;
+}
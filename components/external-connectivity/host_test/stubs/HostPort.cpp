@@ -0,0 +1,349 @@
+// Host implementation of the FreeRTOS, NimBLE porting layer and ESP-IDF functions
+// used by the component
+
+#include <cstdarg>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Simulated time is `simulatedBaseUs` at `realBase` and runs `scale` times faster
+std::mutex timeMutex;
+Clock::time_point realBase{Clock::now()};
+int64_t simulatedBaseUs{0};
+double scale{1};
+
+int64_t simulatedNowUs(Clock::time_point now) {
+    const auto realUs{
+        std::chrono::duration_cast<std::chrono::microseconds>(now - realBase).count()};
+    return simulatedBaseUs + static_cast<int64_t>(realUs * scale);
+}
+
+Clock::duration realDuration(int64_t simulatedUs) {
+    std::lock_guard lock{timeMutex};
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::micro>(simulatedUs / scale));
+}
+
+Clock::time_point realTimePoint(int64_t simulatedUs) {
+    std::lock_guard lock{timeMutex};
+    return realBase + std::chrono::duration_cast<Clock::duration>(
+                          std::chrono::duration<double, std::micro>(
+                              (simulatedUs - simulatedBaseUs) / scale));
+}
+
+std::atomic<esp_log_level_t> logLevel{ESP_LOG_INFO};
+
+std::mutex randomMutex;
+std::mt19937 randomGenerator{1};
+
+struct TaskDeleted {};
+
+}  // namespace
+
+struct HostTask {
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifications{0};
+};
+
+namespace {
+
+thread_local HostTask *currentTask{nullptr};
+
+}  // namespace
+
+int64_t esp_timer_get_time() {
+    std::lock_guard lock{timeMutex};
+    return simulatedNowUs(Clock::now());
+}
+
+namespace host {
+
+void setTimeScale(double newScale) {
+    std::lock_guard lock{timeMutex};
+    const auto now{Clock::now()};
+    simulatedBaseUs = simulatedNowUs(now);
+    realBase = now;
+    scale = newScale;
+}
+
+void sleepUs(int64_t durationUs) {
+    std::this_thread::sleep_for(realDuration(durationUs));
+}
+
+bool logEnabled(esp_log_level_t level) {
+    return level <= logLevel.load(std::memory_order_relaxed);
+}
+
+void seedRandom(uint32_t seed) {
+    std::lock_guard lock{randomMutex};
+    randomGenerator.seed(seed);
+}
+
+}  // namespace host
+
+void esp_log_level_set(const char *, esp_log_level_t level) {
+    logLevel.store(level, std::memory_order_relaxed);
+}
+
+uint32_t esp_log_timestamp() {
+    return static_cast<uint32_t>(esp_timer_get_time() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *, const char *format, ...) {
+    if (!host::logEnabled(level)) {
+        return;
+    }
+    va_list arguments;
+    va_start(arguments, format);
+    std::vprintf(format, arguments);
+    va_end(arguments);
+}
+
+uint32_t esp_random() {
+    std::lock_guard lock{randomMutex};
+    return randomGenerator();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *,
+                                   uint32_t, void *parameters, UBaseType_t,
+                                   TaskHandle_t *handle, BaseType_t) {
+    auto task{new HostTask{}};
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    std::thread{[function, parameters, task] {
+        currentTask = task;
+        try {
+            function(parameters);
+        } catch (const TaskDeleted &) {
+        }
+    }}.detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stackDepth,
+                       void *parameters, UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameters, priority,
+                                   handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == nullptr || task == currentTask) {
+        throw TaskDeleted{};
+    }
+    std::abort();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (currentTask == nullptr) {
+        // Threads not started as tasks, like the one running the tests
+        currentTask = new HostTask{};
+    }
+    return currentTask;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    host::sleepUs(ticks * 1000LL);
+}
+
+TickType_t xTaskGetTickCount() {
+    return static_cast<TickType_t>(esp_timer_get_time() / 1000);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard lock{task->mutex};
+        task->notifications++;
+    }
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    auto task{xTaskGetCurrentTaskHandle()};
+    std::unique_lock lock{task->mutex};
+    const auto hasNotification{[task] { return task->notifications > 0; }};
+    if (ticks == portMAX_DELAY) {
+        task->notified.wait(lock, hasNotification);
+    } else {
+        task->notified.wait_for(lock, realDuration(ticks * 1000LL), hasNotification);
+    }
+    const auto notifications{task->notifications};
+    if (notifications > 0) {
+        task->notifications = clearOnExit ? 0 : notifications - 1;
+    }
+    return notifications;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+    return 0;
+}
+
+BaseType_t xPortGetCoreID() {
+    return 0;
+}
+
+// A single event queue, run by the task that called `nimble_port_run`. Vectors keep
+// their capacity, so the queue stops allocating once it has grown like the real one.
+struct ble_npl_eventq {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<ble_npl_event *> events;
+    std::vector<ble_npl_callout *> callouts;
+    bool stopped{false};
+};
+
+namespace {
+
+ble_npl_eventq defaultEventQueue;
+
+}  // namespace
+
+void ble_npl_event_init(ble_npl_event *event, ble_npl_event_fn *fn, void *arg) {
+    *event = {fn, arg, false};
+}
+
+void *ble_npl_event_get_arg(ble_npl_event *event) {
+    return event->arg;
+}
+
+void ble_npl_eventq_put(ble_npl_eventq *eventq, ble_npl_event *event) {
+    {
+        std::lock_guard lock{eventq->mutex};
+        if (event->queued) {
+            return;
+        }
+        event->queued = true;
+        eventq->events.push_back(event);
+    }
+    eventq->changed.notify_one();
+}
+
+void ble_npl_callout_init(ble_npl_callout *callout, ble_npl_eventq *eventq,
+                          ble_npl_event_fn *fn, void *arg) {
+    ble_npl_event_init(&callout->event, fn, arg);
+    callout->eventq = eventq;
+    callout->deadlineUs = 0;
+    callout->armed = false;
+}
+
+int ble_npl_callout_reset(ble_npl_callout *callout, ble_npl_time_t ticks) {
+    auto eventq{callout->eventq};
+    {
+        std::lock_guard lock{eventq->mutex};
+        callout->deadlineUs = esp_timer_get_time() + ticks * 1000LL;
+        if (!callout->armed) {
+            callout->armed = true;
+            eventq->callouts.push_back(callout);
+        }
+    }
+    eventq->changed.notify_one();
+    return 0;
+}
+
+void ble_npl_callout_stop(ble_npl_callout *callout) {
+    auto eventq{callout->eventq};
+    std::lock_guard lock{eventq->mutex};
+    callout->armed = false;
+    std::erase(eventq->callouts, callout);
+}
+
+bool ble_npl_callout_is_active(ble_npl_callout *callout) {
+    std::lock_guard lock{callout->eventq->mutex};
+    return callout->armed;
+}
+
+uint32_t ble_npl_time_ms_to_ticks32(uint32_t ms) {
+    return ms;
+}
+
+ble_npl_time_t ble_npl_time_get() {
+    return static_cast<ble_npl_time_t>(esp_timer_get_time() / 1000);
+}
+
+esp_err_t nimble_port_init() {
+    std::lock_guard lock{defaultEventQueue.mutex};
+    defaultEventQueue.stopped = false;
+    return ESP_OK;
+}
+
+void nimble_port_run() {
+    auto &eventq{defaultEventQueue};
+    std::unique_lock lock{eventq.mutex};
+    while (!eventq.stopped) {
+        // Callouts which are due are queued like any other event
+        const auto nowUs{esp_timer_get_time()};
+        auto nextDeadlineUs{INT64_MAX};
+        for (auto callout{eventq.callouts.begin()}; callout != eventq.callouts.end();) {
+            if ((*callout)->deadlineUs > nowUs) {
+                nextDeadlineUs = std::min(nextDeadlineUs, (*callout)->deadlineUs);
+                callout++;
+                continue;
+            }
+            (*callout)->armed = false;
+            if (!(*callout)->event.queued) {
+                (*callout)->event.queued = true;
+                eventq.events.push_back(&(*callout)->event);
+            }
+            callout = eventq.callouts.erase(callout);
+        }
+
+        if (eventq.events.empty()) {
+            if (nextDeadlineUs == INT64_MAX) {
+                eventq.changed.wait(lock);
+            } else {
+                eventq.changed.wait_until(lock, realTimePoint(nextDeadlineUs));
+            }
+            continue;
+        }
+        auto event{eventq.events.front()};
+        eventq.events.erase(eventq.events.begin());
+        event->queued = false;
+        lock.unlock();
+        event->fn(event);
+        lock.lock();
+    }
+}
+
+int nimble_port_stop() {
+    {
+        std::lock_guard lock{defaultEventQueue.mutex};
+        defaultEventQueue.stopped = true;
+    }
+    defaultEventQueue.changed.notify_all();
+    return 0;
+}
+
+ble_npl_eventq *nimble_port_get_dflt_eventq() {
+    return &defaultEventQueue;
+}
+
+void nimble_port_freertos_init(TaskFunction_t function) {
+    xTaskCreate(function, "nimble_host", 4096, nullptr, configMAX_PRIORITIES - 4,
+                nullptr);
+}
+
+void nimble_port_freertos_deinit() {
+}
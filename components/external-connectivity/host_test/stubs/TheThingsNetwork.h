@@ -0,0 +1,17 @@
+#pragma once
+
+// The part of the ttn-esp32 API used outside of `TtnLoraMac`
+
+#include <cstddef>
+#include <cstdint>
+
+typedef uint8_t port_t;
+
+enum TTNResponseCode {
+    kTTNErrorTransmissionFailed = -1,
+    kTTNErrorUnexpected = -10,
+    kTTNSuccessfulTransmission = 1,
+    kTTNSuccessfulReceive = 2,
+};
+
+typedef void (*TTNMessageCallback)(const uint8_t *payload, size_t length, port_t port);
@@ -0,0 +1,15 @@
+#pragma once
+
+// Version of the host build, set by CMake to the checked out commit
+#ifndef EXT_CON_HOST_VERSION
+#define EXT_CON_HOST_VERSION "host"
+#endif
+
+typedef struct {
+    char version[32];
+} esp_app_desc_t;
+
+inline const esp_app_desc_t *esp_app_get_description() {
+    static const esp_app_desc_t description{EXT_CON_HOST_VERSION};
+    return &description;
+}
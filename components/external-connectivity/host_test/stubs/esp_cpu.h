@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Time stamp counter where the host has one, which ticks at a fixed rate rather than
+// the core clock; zero otherwise
+inline uint32_t esp_cpu_get_cycle_count() {
+#if defined(__x86_64__) || defined(__i386__)
+    return static_cast<uint32_t>(__rdtsc());
+#else
+    return 0;
+#endif
+}
+
+inline int esp_cpu_get_core_id() {
+    return 0;
+}
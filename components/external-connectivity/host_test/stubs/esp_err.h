@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT 0x107
+
+#define ESP_ERROR_CHECK(x)                                                       \
+    do {                                                                         \
+        const esp_err_t error = (x);                                             \
+        if (error != ESP_OK) {                                                   \
+            std::fprintf(stderr, "ESP_ERROR_CHECK failed: 0x%x at %s:%d\n", error, \
+                         __FILE__, __LINE__);                                    \
+            std::abort();                                                        \
+        }                                                                        \
+    } while (0)
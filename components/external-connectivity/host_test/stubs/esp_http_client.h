@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Only the form encoding of `HttpClient` is built on the host, the client itself
+// needs the ESP-IDF HTTP client
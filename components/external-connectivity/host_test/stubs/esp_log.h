@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ESP_LOG_INFO
+#endif
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+uint32_t esp_log_timestamp();
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...);
+
+namespace host {
+
+bool logEnabled(esp_log_level_t level);
+
+// Format strings are written for the ESP32, where `uint32_t` is `unsigned long` and
+// `size_t` is `unsigned int`. Integers are widened to 64 bits, so `%d`, `%lu` and
+// `%lld` all find their argument in the 64-bit argument slots of the host ABI.
+template <typename T>
+auto logArgument(const T &value) {
+    if constexpr (std::is_enum_v<T>) {
+        return static_cast<long long>(value);
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        return static_cast<long long>(value);
+    } else if constexpr (std::is_integral_v<T>) {
+        return static_cast<unsigned long long>(value);
+    } else {
+        return value;
+    }
+}
+
+template <typename... Args>
+void log(esp_log_level_t level, const char *tag, const char *format,
+         const Args &...arguments) {
+    if (!logEnabled(level)) {
+        return;
+    }
+    constexpr char levelLetters[]{"NEWIDV"};
+    flockfile(stdout);
+    std::printf("%c (%lu) %s: ", levelLetters[level],
+                static_cast<unsigned long>(esp_log_timestamp()), tag);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-security"
+    std::printf(format, logArgument(arguments)...);
+#pragma GCC diagnostic pop
+    std::printf("\n");
+    funlockfile(stdout);
+}
+
+}  // namespace host
+
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...)                   \
+    do {                                                               \
+        if (LOG_LOCAL_LEVEL >= level) {                                \
+            host::log(level, tag, format __VA_OPT__(, ) __VA_ARGS__); \
+        }                                                              \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, tag, format __VA_OPT__(, ) __VA_ARGS__)
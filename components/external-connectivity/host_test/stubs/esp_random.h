@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Deterministic sequence, see `host::seedRandom`
+uint32_t esp_random();
+
+namespace host {
+
+void seedRandom(uint32_t seed);
+
+}  // namespace host
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+// The host heap is not bounded
+inline uint32_t esp_get_free_heap_size() {
+    return 0;
+}
+
+inline uint32_t esp_get_minimum_free_heap_size() {
+    return 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// Microseconds since start, in simulated time, see `host::setTimeScale`
+int64_t esp_timer_get_time();
+
+namespace host {
+
+// Runs simulated time `scale` times faster than real time, so that scenarios spanning
+// minutes of LoRa duty cycle finish in seconds. Delays and timeouts of tasks and
+// NimBLE callouts are scaled as well.
+void setTimeScale(double scale);
+// Sleeps for a duration of simulated time
+void sleepUs(int64_t durationUs);
+
+}  // namespace host
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Tasks are threads and ticks are milliseconds of simulated time, there is no
+// scheduler: priorities and core affinities are ignored.
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct HostTask *TaskHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY UINT32_MAX
+#define portTICK_PERIOD_MS 1
+#define portNUM_PROCESSORS 1
+#define pdMS_TO_TICKS(ms) static_cast<TickType_t>(ms)
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define configMAX_PRIORITIES 25
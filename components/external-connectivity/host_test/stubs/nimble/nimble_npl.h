@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Event queue and callouts of the NimBLE porting layer, run by `nimble_port_run`
+
+struct ble_npl_event;
+typedef void ble_npl_event_fn(struct ble_npl_event *event);
+
+struct ble_npl_event {
+    ble_npl_event_fn *fn;
+    void *arg;
+    bool queued;
+};
+
+struct ble_npl_eventq;
+
+struct ble_npl_callout {
+    struct ble_npl_event event;
+    struct ble_npl_eventq *eventq;
+    int64_t deadlineUs;
+    bool armed;
+};
+
+typedef uint32_t ble_npl_time_t;
+
+void ble_npl_event_init(struct ble_npl_event *event, ble_npl_event_fn *fn, void *arg);
+void *ble_npl_event_get_arg(struct ble_npl_event *event);
+void ble_npl_eventq_put(struct ble_npl_eventq *eventq, struct ble_npl_event *event);
+
+void ble_npl_callout_init(struct ble_npl_callout *callout, struct ble_npl_eventq *eventq,
+                          ble_npl_event_fn *fn, void *arg);
+int ble_npl_callout_reset(struct ble_npl_callout *callout, ble_npl_time_t ticks);
+void ble_npl_callout_stop(struct ble_npl_callout *callout);
+bool ble_npl_callout_is_active(struct ble_npl_callout *callout);
+
+// Ticks are milliseconds
+uint32_t ble_npl_time_ms_to_ticks32(uint32_t ms);
+ble_npl_time_t ble_npl_time_get();
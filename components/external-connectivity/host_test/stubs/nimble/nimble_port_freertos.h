@@ -0,0 +1,7 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// Starts the host task running `function`
+void nimble_port_freertos_init(TaskFunction_t function);
+void nimble_port_freertos_deinit();
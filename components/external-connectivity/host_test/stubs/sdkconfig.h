@@ -0,0 +1,35 @@
+#pragma once
+
+// Configuration of the host build. Features toggled per test binary, like static
+// memory or deferred logging, are defined by the build instead.
+
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_UNICORE 1
+
+#define CONFIG_EXT_CON_LORA_ENABLE 1
+#define CONFIG_EXT_CON_LORA_SIMULATED 1
+#define CONFIG_EXT_CON_LORA_SIM_SPREADING_FACTOR 7
+#define CONFIG_EXT_CON_LORA_SIM_LOSS_PERCENT 5
+#define CONFIG_EXT_CON_LORA_DR_POLICY_ADR 1
+#define CONFIG_EXT_CON_LORA_MAX_TX_POWER 14
+#define CONFIG_EXT_CON_LORA_CONFIRMED_PORTS ""
+#define CONFIG_EXT_CON_LORA_REJOIN_THRESHOLD 4
+#define CONFIG_EXT_CON_LORA_APP_EUI "0000000000000000"
+#define CONFIG_EXT_CON_LORA_APP_KEY "00000000000000000000000000000000"
+#define CONFIG_EXT_CON_LORA_DEV_EUI "0000000000000000"
+#define CONFIG_EXT_CON_HEALTH_UPLINK_INTERVAL 0
+#define CONFIG_EXT_CON_UPLINK_QUEUE_SIZE 100
+
+#define CONFIG_EXT_CON_BLE_VIRTUAL_PERIPHERAL 1
+#define CONFIG_EXT_CON_BLE_VIRTUAL_PERIPHERAL_SCRIPT \
+    "current_measurement:10,voltage_measurement:10,temperature:0.2"
+#define CONFIG_EXT_CON_AGGREGATION_WINDOW_MS 60000
+
+#define CONFIG_EXT_CON_TRANSPORT_TASK_CORE -1
+#define CONFIG_EXT_CON_LORA_TASK_PRIORITY 1
+#define CONFIG_EXT_CON_LORA_TASK_STACK_SIZE 4096
+
+#define CONFIG_EXT_CON_TRACING_RING_SIZE 128
+#define CONFIG_EXT_CON_MAX_PAYLOAD_SIZE 64
+#define CONFIG_EXT_CON_HTTP_BODY_SIZE 512
+#define CONFIG_EXT_CON_DEFERRED_LOG_CAPACITY 64
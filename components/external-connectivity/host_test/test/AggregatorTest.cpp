@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include <Aggregator.hpp>
+#include <LoraMac.hpp>
+#include <string>
+#include <vector>
+
+namespace extcon::telemetry {
+namespace {
+
+struct Summary {
+    Uuid uuid;
+    std::string text;
+};
+
+class AggregatorTest : public testing::Test {
+protected:
+    Aggregator make(bool withVariance) {
+        return Aggregator{1000, withVariance, [this](Uuid uuid, std::string_view text) {
+                              summaries.push_back({uuid, std::string{text}});
+                          }};
+    }
+
+    std::vector<Summary> summaries;
+};
+
+TEST_F(AggregatorTest, EmitsOneSummaryPerClosedWindow) {
+    auto aggregator{make(false)};
+    EXPECT_TRUE(aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 2, 0));
+    EXPECT_TRUE(aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 4, 500));
+    EXPECT_TRUE(aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 3, 999));
+    EXPECT_TRUE(summaries.empty());
+
+    // The first sample of the next window closes the previous one
+    EXPECT_TRUE(aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 10, 1000));
+    ASSERT_EQ(summaries.size(), 1u);
+    EXPECT_EQ(summaries[0].uuid, GATT_CHR_CURRENT_MEASUREMENT);
+    EXPECT_EQ(summaries[0].text, "2/4/3/3/3");
+}
+
+TEST_F(AggregatorTest, IgnoresCharacteristicsWithoutSeries) {
+    auto aggregator{make(false)};
+    EXPECT_FALSE(aggregator.add(GATT_CHR_RELAY, 1, 0));
+    aggregator.flush(5000);
+    EXPECT_TRUE(summaries.empty());
+}
+
+TEST_F(AggregatorTest, ReportsPopulationVariance) {
+    auto aggregator{make(true)};
+    for (const float value : {2, 4, 4, 4, 5, 5, 7, 9}) {
+        aggregator.add(GATT_CHR_VOLTAGE_MEASUREMENT, value, 100);
+    }
+    aggregator.flush(1000);
+    ASSERT_EQ(summaries.size(), 1u);
+    EXPECT_EQ(summaries[0].text, "2/9/5/9/8/4");
+}
+
+TEST_F(AggregatorTest, FlushOnlyClosesPastWindows) {
+    auto aggregator{make(false)};
+    aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 1, 1500);
+    aggregator.add(GATT_CHR_VOLTAGE_MEASUREMENT, 230, 1500);
+    aggregator.flush(1999);
+    EXPECT_TRUE(summaries.empty());
+
+    aggregator.flush(2000);
+    ASSERT_EQ(summaries.size(), 2u);
+    // Both series are empty again, a later flush emits nothing
+    aggregator.flush(10000);
+    EXPECT_EQ(summaries.size(), 2u);
+}
+
+TEST_F(AggregatorTest, ResetsStatisticsBetweenWindows) {
+    auto aggregator{make(true)};
+    aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 100, 0);
+    aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, -100, 0);
+    aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 1, 3000);
+    aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, 1, 3500);
+    aggregator.flush(4000);
+
+    ASSERT_EQ(summaries.size(), 2u);
+    EXPECT_EQ(summaries[0].text, "-100/100/0/-100/2/1e+04");
+    EXPECT_EQ(summaries[1].text, "1/1/1/1/2/0");
+}
+
+TEST_F(AggregatorTest, SummaryFitsTheSmallestPayload) {
+    static_assert(Aggregator::maxSummaryLength <= lora::maxPayloadSizes[0]);
+    auto aggregator{make(true)};
+    for (uint32_t i = 0; i < Aggregator::maxSamples; i++) {
+        aggregator.add(GATT_CHR_CURRENT_MEASUREMENT, i % 2 ? -1.23e38f : 3.21e38f, 0);
+    }
+
+    // The full window is emitted without waiting for it to end
+    ASSERT_EQ(summaries.size(), 1u);
+    EXPECT_LE(summaries[0].text.size(), Aggregator::maxSummaryLength);
+    EXPECT_EQ(summaries[0].text, "-1.23e+38/3.21e+38/9.92e+37/3.21e+38/999/4.9e+76");
+}
+
+}  // namespace
+}  // namespace extcon::telemetry
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace extcon::test {
+
+// Heap allocations made by any thread since the process started, counted by the
+// replaced `malloc` family, which `operator new` ends up in as well
+uint64_t allocationCount();
+
+}  // namespace extcon::test
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <DeferredLog.hpp>
+
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+
+namespace extcon::logging {
+namespace {
+
+DeferredLog::Record makeRecord(const char *format,
+                               std::initializer_list<uint64_t> arguments) {
+    DeferredLog::Record record{};
+    record.format = format;
+    for (const auto argument : arguments) {
+        record.arguments[record.argumentCount++].integer = argument;
+    }
+    return record;
+}
+
+TEST(DeferredLogTest, FormatsIntegersWithWidthAndFlags) {
+    const auto record{makeRecord("Found address: %02X:%02X:%02X:%02X:%02X:%02X",
+                                 {0xc8, 0xc9, 0xa3, 0xc6, 0x5f, 0x0a})};
+    char buffer[64];
+    const auto length{DeferredLog::format(record, buffer, sizeof(buffer))};
+    EXPECT_EQ(std::string(buffer, length), "Found address: C8:C9:A3:C6:5F:0A");
+}
+
+TEST(DeferredLogTest, TruncatesToTheBuffer) {
+    const auto record{makeRecord("%lu%% of %d", {42, 100})};
+    char buffer[6];
+    EXPECT_EQ(DeferredLog::format(record, buffer, sizeof(buffer)), 5u);
+    EXPECT_STREQ(buffer, "42% o");
+}
+
+TEST(DeferredLogTest, AcceptsAsteriskOutsideConversions) {
+    // Asterisk widths and precisions fail to compile, see `DeferredLog::Format`
+    constexpr DeferredLog::Format format{"%d%%* and *"};
+    EXPECT_STREQ(format.string, "%d%%* and *");
+}
+
+}  // namespace
+}  // namespace extcon::logging
+
+#endif
@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    const int result{RUN_ALL_TESTS()};
+    // Service tasks run forever and use static state, so skip static destructors
+    std::fflush(stdout);
+    std::_Exit(result);
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <MessageBus.hpp>
+#include <array>
+#include <thread>
+#include <vector>
+
+namespace extcon::bus {
+namespace {
+
+using metrics::Counter;
+using metrics::Histogram;
+using metrics::Metrics;
+
+TEST(MpscQueue, KeepsOrderUpToCapacity) {
+    MpscQueue<uint32_t, 4> queue;
+    for (uint32_t value = 0; value < 4; value++) {
+        EXPECT_TRUE(queue.push(value));
+    }
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_EQ(queue.size(), 4u);
+
+    uint32_t value;
+    for (uint32_t expected = 0; expected < 4; expected++) {
+        ASSERT_TRUE(queue.pop(value));
+        EXPECT_EQ(value, expected);
+    }
+    EXPECT_FALSE(queue.pop(value));
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(MpscQueue, DeliversEveryValueOfConcurrentProducers) {
+    constexpr uint32_t producers{4};
+    constexpr uint32_t valuesPerProducer{100000};
+    MpscQueue<uint32_t, 64> queue;
+
+    std::vector<std::thread> threads;
+    for (uint32_t producer = 0; producer < producers; producer++) {
+        threads.emplace_back([&queue, producer] {
+            for (uint32_t sequence = 0; sequence < valuesPerProducer; sequence++) {
+                while (!queue.push(producer << 24 | sequence)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Values of each producer arrive in the order they were pushed
+    std::array<uint32_t, producers> nextSequence{};
+    uint32_t received{0};
+    uint32_t value;
+    while (received < producers * valuesPerProducer) {
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const auto producer{value >> 24};
+        ASSERT_LT(producer, producers);
+        ASSERT_EQ(value & 0xFFFFFF, nextSequence[producer]);
+        nextSequence[producer]++;
+        received++;
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_FALSE(queue.pop(value));
+}
+
+struct Probe {
+    uint32_t sequence;
+};
+
+TEST(Mailbox, CountsDropsWhenFull) {
+    Mailbox<Probe, 2> mailbox{"Probe", Counter::BusDrops, Histogram::BusProbeLatencyUs,
+                              1};
+    const auto dropsBefore{Metrics::get(Counter::BusDrops)};
+
+    EXPECT_TRUE(mailbox.deliver({1}, esp_timer_get_time()));
+    EXPECT_TRUE(mailbox.deliver({2}, esp_timer_get_time()));
+    EXPECT_FALSE(mailbox.deliver({3}, esp_timer_get_time()));
+    EXPECT_EQ(Metrics::get(Counter::BusDrops) - dropsBefore, 1u);
+
+    Probe probe;
+    ASSERT_TRUE(mailbox.pop(probe));
+    EXPECT_EQ(probe.sequence, 1u);
+    ASSERT_TRUE(mailbox.pop(probe));
+    EXPECT_EQ(probe.sequence, 2u);
+    EXPECT_FALSE(mailbox.pop(probe));
+}
+
+struct Broadcast {
+    uint32_t sequence;
+};
+
+TEST(Topic, DeliversToEverySubscriber) {
+    Mailbox<Broadcast, 4> first{"First", Counter::BusDrops, Histogram::BusProbeLatencyUs,
+                                1};
+    Mailbox<Broadcast, 1> second{"Second", Counter::MqttQueueDrops,
+                                 Histogram::BusProbeLatencyUs, 1};
+    Topic<Broadcast>::subscribe(first);
+    Topic<Broadcast>::subscribe(second);
+    const auto firstDropsBefore{Metrics::get(Counter::BusDrops)};
+    const auto secondDropsBefore{Metrics::get(Counter::MqttQueueDrops)};
+
+    EXPECT_TRUE(Topic<Broadcast>::publish({1}));
+    // The second mailbox is full, the first one still gets the message
+    EXPECT_FALSE(Topic<Broadcast>::publish({2}));
+    // Only the subscriber that dropped the message counts it
+    EXPECT_EQ(Metrics::get(Counter::BusDrops), firstDropsBefore);
+    EXPECT_EQ(Metrics::get(Counter::MqttQueueDrops) - secondDropsBefore, 1u);
+
+    Broadcast message;
+    EXPECT_EQ(first.size(), 2u);
+    ASSERT_TRUE(second.pop(message));
+    EXPECT_EQ(message.sequence, 1u);
+    EXPECT_FALSE(second.pop(message));
+}
+
+}  // namespace
+}  // namespace extcon::bus
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include <Metrics.hpp>
+#include <array>
+
+namespace extcon::metrics {
+namespace {
+
+uint32_t field(const uint8_t *report, size_t index) {
+    const auto value{report + 1 + 4 * index};
+    return value[0] | value[1] << 8 | value[2] << 16 | value[3] << 24;
+}
+
+TEST(Metrics, HealthReportFitsTheSlowestDataRates) {
+    std::array<uint8_t, 64> report{};
+    Metrics::increment(Counter::UplinkQueueDrops, 0x12345);
+
+    const auto length{Metrics::healthReport(report.data(), 51)};
+    EXPECT_EQ(length, 49u);
+    EXPECT_EQ(report[0], Metrics::healthReportVersion);
+    EXPECT_EQ(field(report.data(), 2), Metrics::get(Counter::UplinkQueueDrops));
+    // Nothing past the last whole field
+    EXPECT_EQ(report[49], 0);
+}
+
+TEST(Metrics, HealthReportStopsAtTheFirstFieldThatDoesNotFit) {
+    std::array<uint8_t, 16> report{};
+    EXPECT_EQ(Metrics::healthReport(report.data(), 11), 9u);
+    EXPECT_EQ(Metrics::healthReport(report.data(), 1), 1u);
+    EXPECT_EQ(Metrics::healthReport(report.data(), 0), 0u);
+}
+
+}  // namespace
+}  // namespace extcon::metrics
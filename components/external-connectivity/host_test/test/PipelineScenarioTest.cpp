@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <DeferredLog.hpp>
+#include <LoraService.hpp>
+#include <MessageBus.hpp>
+#include <Metrics.hpp>
+#include <Pipeline.hpp>
+#include <Tracing.hpp>
+#include <VirtualPeripheral.hpp>
+#include <atomic>
+#include <numeric>
+
+#include "AllocationCounter.hpp"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nimble/nimble_port.h"
+
+namespace extcon {
+namespace {
+
+using metrics::Counter;
+using metrics::Histogram;
+using metrics::Metrics;
+
+class UplinkCounter final : public bus::Subscription<bus::Uplink> {
+public:
+    bool deliver(const bus::Uplink &, int64_t) override {
+        published.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::atomic<uint32_t> published{0};
+};
+
+uint32_t sampleCount(Histogram histogram) {
+    const auto buckets{Metrics::snapshot(histogram)};
+    return std::accumulate(buckets.begin(), buckets.end(), uint32_t{0});
+}
+
+// Virtual peripheral notifying far faster than LoRa at SF7 can carry, through the
+// pipeline and the bus into the LoRa service on the simulated MAC
+TEST(PipelineScenario, OverloadIsDroppedAndAccountedFor) {
+    constexpr int64_t durationUs{300 * 1000000LL};
+    host::setTimeScale(100);
+    // Every dropped reading is logged
+    esp_log_level_set("*", ESP_LOG_ERROR);
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+    logging::DeferredLog::start();
+#endif
+
+    static UplinkCounter uplinks;
+    bus::Topic<bus::Uplink>::subscribe(uplinks);
+    static ble::VirtualPeripheral peripheral{
+        "current_measurement:10,voltage_measurement:10,temperature:0.2"};
+    ASSERT_TRUE(peripheral.init());
+    telemetry::Pipeline::init(peripheral);
+    static lora::LoraService loraService{CONFIG_EXT_CON_LORA_APP_EUI,
+                                         CONFIG_EXT_CON_LORA_APP_KEY,
+                                         CONFIG_EXT_CON_LORA_DEV_EUI};
+    ASSERT_TRUE(loraService.init());
+    peripheral.start();
+    loraService.start(true);
+
+    host::sleepUs(durationUs / 2);
+    bus::Topic<bus::PeripheralWrite>::publish(
+        {GATT_CHR_RELAY, bus::Payload{std::string_view{"1"}}});
+    host::sleepUs(10 * 1000000LL);
+    // Steady state: queues are full, every reading is formatted, published and either
+    // queued or dropped, and the MAC keeps transmitting
+    const auto allocationsBefore{test::allocationCount()};
+    host::sleepUs(durationUs / 2 - 10 * 1000000LL);
+    const auto steadyStateAllocations{test::allocationCount() - allocationsBefore};
+    // Stops the peripheral, so that the counters settle
+    nimble_port_stop();
+    host::sleepUs(1000000);
+    esp_log_level_set("*", ESP_LOG_INFO);
+
+    const auto emitted{ble::VirtualPeripheral::emitted()};
+    const auto published{uplinks.published.load()};
+    const auto queued{Metrics::get(Counter::UplinksQueued)};
+    const auto dropped{Metrics::get(Counter::UplinkQueueDrops)};
+    const auto transmitted{Metrics::get(Counter::UplinksSent) +
+                           Metrics::get(Counter::UplinksFailed)};
+    std::printf("%u readings, %u published, %u queued, %u dropped, %u transmitted\n",
+                emitted, published, queued, dropped, transmitted);
+    Metrics::printPercentiles("LoRa queue",
+                              Metrics::snapshot(Histogram::LoraQueueLatencyMs));
+    Metrics::printPercentiles("transmit",
+                              Metrics::snapshot(Histogram::TransmitLatencyMs));
+    loraService.printStatistics();
+
+    // Around 20 readings per second for 300 s
+    EXPECT_GT(emitted, 5000u);
+    EXPECT_EQ(emitted, published + Metrics::get(Counter::AllocationFailures));
+    // Every published uplink was either queued or dropped by the LoRa mailbox
+    EXPECT_EQ(queued + dropped, published);
+    EXPECT_GT(dropped, published / 2);
+    // One uplink every few seconds at SF7 within the 1% duty cycle
+    EXPECT_GT(transmitted, 10u);
+    EXPECT_LT(transmitted, 100u);
+    EXPECT_LE(transmitted, queued);
+    EXPECT_LE(queued - transmitted, lora::uplinkQueueSize + 1);
+    EXPECT_GE(sampleCount(Histogram::LoraQueueLatencyMs), transmitted);
+    EXPECT_EQ(ble::VirtualPeripheral::written(), 1u);
+#ifdef CONFIG_EXT_CON_STATIC_MEMORY
+    EXPECT_EQ(steadyStateAllocations, 0u);
+#else
+    std::printf("%lu heap allocations in steady state\n",
+                static_cast<unsigned long>(steadyStateAllocations));
+#endif
+#ifdef CONFIG_EXT_CON_TRACING_ENABLE
+    tracing::Tracer::printPercentiles();
+#endif
+}
+
+}  // namespace
+}  // namespace extcon
@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+
+#include <ScriptedModem.hpp>
+
+namespace extcon::gsm {
+namespace {
+
+TEST(ScriptedModem, AnswersQueriesInCommandMode) {
+    ScriptedModem modem{{
+        {"AT+CSQ", "+CSQ: 21,0", 10},
+        {"AT+COPS?", "+COPS: 0,0,\"Orange PL\",2", 10},
+    }};
+
+    int rssi{}, ber{};
+    ASSERT_TRUE(modem.signalQuality(rssi, ber));
+    EXPECT_EQ(rssi, 21);
+    EXPECT_EQ(ber, 0);
+
+    std::string name;
+    int access{};
+    ASSERT_TRUE(modem.operatorName(name, access));
+    EXPECT_EQ(name, "Orange PL");
+    EXPECT_EQ(access, 2);
+    EXPECT_EQ(modem.pending(), 0u);
+}
+
+TEST(ScriptedModem, FailsOnErrorTimeoutAndUnexpectedCommands) {
+    ScriptedModem modem{{
+        {"AT+CFUN=1,1", "ERROR", 10},
+        {"AT+CSQ", "+CSQ: 21,0", 1000},
+        {"AT", "OK", 10},
+    }};
+
+    std::string response;
+    EXPECT_FALSE(modem.at("AT+CFUN=1,1", response, 500));
+    EXPECT_FALSE(modem.at("AT+CSQ", response, 500));
+    EXPECT_FALSE(modem.at("AT+COPS?", response, 500));
+    EXPECT_TRUE(modem.at("AT", response, 500));
+    EXPECT_EQ(response, "OK");
+}
+
+TEST(ScriptedModem, DialsAndHangsUpPpp) {
+    ScriptedModem modem{{
+        {"ATD*99#", "CONNECT 115200", 100},
+        {"+++", "OK", 10},
+        {"AT+CSQ", "+CSQ: 15,99", 10},
+    }};
+
+    ASSERT_TRUE(modem.setMode(ModemMode::Data));
+    EXPECT_EQ(modem.mode(), ModemMode::Data);
+    // The link carries PPP frames now, AT commands are not answered
+    std::string response;
+    EXPECT_FALSE(modem.at("AT+CSQ", response, 500));
+
+    ASSERT_TRUE(modem.setMode(ModemMode::Command));
+    int rssi{}, ber{};
+    ASSERT_TRUE(modem.signalQuality(rssi, ber));
+    EXPECT_EQ(rssi, 15);
+}
+
+TEST(ScriptedModem, StaysInCommandModeWithoutCarrier) {
+    ScriptedModem modem{{{"ATD*99#", "NO CARRIER", 100}}};
+
+    EXPECT_FALSE(modem.setMode(ModemMode::Data));
+    EXPECT_EQ(modem.mode(), ModemMode::Command);
+}
+
+}  // namespace
+}  // namespace extcon::gsm
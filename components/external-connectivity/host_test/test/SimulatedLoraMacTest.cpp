@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <LoraMac.hpp>
+
+#include "esp_timer.h"
+
+namespace extcon::lora {
+namespace {
+
+constexpr uint8_t payload[10]{};
+
+class SimulatedLoraMacTest : public testing::Test {
+protected:
+    void SetUp() override {
+        host::setTimeScale(1000);
+    }
+
+    void TearDown() override {
+        host::setTimeScale(1);
+    }
+};
+
+TEST(LoraMac, AirtimeMatchesSemtechCalculator) {
+    EXPECT_EQ(LoraMac::airtimeMs(5, 10), 62u);
+    EXPECT_EQ(LoraMac::airtimeMs(5, 51), 119u);
+    EXPECT_EQ(LoraMac::airtimeMs(0, 10), 1483u);
+    EXPECT_EQ(LoraMac::airtimeMs(0, 51), 2794u);
+}
+
+TEST(LoraMac, KeyFingerprintIsFnv1aOfTheKeys) {
+    EXPECT_EQ(LoraMac::keyFingerprint("", "", ""), 0x811c9dc5u);
+    EXPECT_EQ(LoraMac::keyFingerprint("", "", "a"), 0xe40c292cu);
+    EXPECT_EQ(LoraMac::keyFingerprint("a", "", ""), 0xe40c292cu);
+    const auto fingerprint{LoraMac::keyFingerprint("0011", "2233", "4455")};
+    EXPECT_NE(LoraMac::keyFingerprint("0011", "2233", "4456"), fingerprint);
+    EXPECT_NE(LoraMac::keyFingerprint("0012", "2233", "4455"), fingerprint);
+}
+
+TEST_F(SimulatedLoraMacTest, UnconfirmedUplinksSucceedDespiteLoss) {
+    SimulatedLoraMac mac{7, 100};
+    EXPECT_EQ(mac.transmitMessage(payload, sizeof(payload), 1, false),
+              kTTNSuccessfulTransmission);
+}
+
+TEST_F(SimulatedLoraMacTest, ConfirmedUplinksNeedAcknowledgement) {
+    SimulatedLoraMac lossy{7, 100};
+    EXPECT_EQ(lossy.transmitMessage(payload, sizeof(payload), 1, true),
+              kTTNErrorTransmissionFailed);
+    SimulatedLoraMac lossless{7, 0};
+    EXPECT_EQ(lossless.transmitMessage(payload, sizeof(payload), 1, true),
+              kTTNSuccessfulTransmission);
+}
+
+TEST_F(SimulatedLoraMacTest, RetransmitsConfirmedUplinksAtLowerDataRates) {
+    SimulatedLoraMac lossy{7, 100};
+    const auto startUs{esp_timer_get_time()};
+    EXPECT_EQ(lossy.transmitMessage(payload, sizeof(payload), 1, true),
+              kTTNErrorTransmissionFailed);
+    // Eight transmissions, the last two at DR2, each one waiting for the duty cycle of
+    // the one before, which takes longer than the first two at DR5 alone
+    EXPECT_EQ(lossy.dataRate(), 2);
+    EXPECT_GE(esp_timer_get_time() - startUs, 2 * 100 * 62 * 1000LL);
+}
+
+TEST_F(SimulatedLoraMacTest, ReportsTheUplinkDataRateAfterTheReceiveWindows) {
+    SimulatedLoraMac mac{7, 0};
+    mac.setDataRate(4);
+    mac.transmitMessage(payload, sizeof(payload), 1, false);
+    // The radio last listened in RX2 at DR0, where only 51 bytes fit, while the next
+    // uplink still goes out at DR4
+    EXPECT_EQ(mac.radioDataRate(), 0);
+    EXPECT_EQ(mac.dataRate(), 4);
+    EXPECT_EQ(maxPayloadSizes[mac.dataRate()], 222u);
+}
+
+TEST_F(SimulatedLoraMacTest, WaitsForDutyCycle) {
+    SimulatedLoraMac mac{7, 0};
+    mac.transmitMessage(payload, sizeof(payload), 1, false);
+    const auto startUs{esp_timer_get_time()};
+    mac.transmitMessage(payload, sizeof(payload), 1, false);
+    // The sub-band stays blocked for 99 times the airtime of the first uplink, of which
+    // its 1 s receive windows already passed
+    EXPECT_GE(esp_timer_get_time() - startUs, (99 * 62 - 1000) * 1000);
+}
+
+}  // namespace
+}  // namespace extcon::lora
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+#include "InternalMappings.hpp"
+
+namespace extcon::telemetry {
+
+// Keeps streaming statistics of numeric characteristic values over tumbling windows
+// and emits one summary per series and window, formatted as
+// `min/max/mean/last/count[/variance]`.
+// Values keep three significant digits and the variance two, and a window is closed
+// early once it holds `maxSamples` values, so a summary never exceeds
+// `maxSummaryLength` and fits the 51 bytes allowed at the slowest data rates.
+class Aggregator {
+public:
+    using Sink = std::function<void(Uuid uuid, std::string_view summary)>;
+
+    static constexpr uint32_t maxSamples{999};
+    // Four signed values like `-1.23e+38`, a three-digit count, an unsigned variance
+    // like `1.2e+38` and the separators
+    static constexpr size_t maxSummaryLength{4 * 9 + 3 + 7 + 5};
+
+    Aggregator(uint32_t windowMs, bool withVariance, Sink sink);
+
+    bool add(Uuid uuid, float value, int64_t nowMs);
+    void flush(int64_t nowMs);
+
+private:
+    struct Series {
+        Uuid uuid;
+        int64_t window;
+        uint32_t count;
+        float min;
+        float max;
+        float last;
+        double mean;
+        double m2;
+    };
+
+    void emit(Series &series);
+
+    const uint32_t windowMs;
+    const bool withVariance;
+    const Sink sink;
+    std::array<Series, aggregatedCharacteristics.size()> series{};
+};
+
+}  // namespace extcon::telemetry
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <esp_cpu.h>
+#include <esp_timer.h>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace extcon::bench {
+
+// Microbenchmarks of the gateway hot paths. Every result is printed as a single JSON
+// line tagged with the firmware version, so runs can be collected and compared. The
+// host build runs all but the NimBLE ones, see `host_test`.
+class Benchmark {
+public:
+    static void runAll();
+
+    template <typename Function>
+    static void run(const char *name, uint32_t iterations, Function &&function);
+
+private:
+    static void runPinned(void *caller);
+    static void runBenchmarks();
+
+    template <typename T>
+    static void doNotOptimize(const T &value);
+
+    static void report(const char *name, uint32_t iterations, uint32_t cycles,
+                       int64_t elapsedUs);
+};
+
+template <typename Function>
+void Benchmark::run(const char *name, uint32_t iterations, Function &&function) {
+    // Keep iterations low enough for the 32-bit cycle counter not to wrap
+    const auto invoke{[&function] {
+        if constexpr (std::is_void_v<decltype(function())>) {
+            function();
+        } else {
+            doNotOptimize(function());
+        }
+    }};
+
+    invoke();
+    const auto startUs{esp_timer_get_time()};
+    const auto startCycles{esp_cpu_get_cycle_count()};
+    for (uint32_t i = 0; i < iterations; i++) {
+        invoke();
+    }
+    const uint32_t cycles{esp_cpu_get_cycle_count() - startCycles};
+    report(name, iterations, cycles, esp_timer_get_time() - startUs);
+}
+
+template <typename T>
+void Benchmark::doNotOptimize(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+}  // namespace extcon::bench
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <string>
+#include <PeripheralLink.hpp>
+#include <sdkconfig.h>
+#include <string_view>
 
 #include "InternalMappings.hpp"
 #include "host/ble_hs.h"
@@ -13,18 +15,20 @@
 
 namespace extcon::ble {
 
-class BleService {
+// Connects to the peripheral over NimBLE, forwards its notified and polled values to
+// `telemetry::Pipeline` and writes values to its characteristics
+class BleService : public PeripheralLink {
 public:
     BleService() = default;
 
-    static void writeValue(Uuid uuid, const std::string &value);
-
-    bool init();
-    void start();
+    bool init() override;
+    void start() override;
+    void writeValue(Uuid uuid, std::string_view value) override;
 
+private:
+    // Only accessed on the NimBLE host task
     static const peer *connectedPeer;
 
-private:
     static void loop(void *);
     static void scanDevices();
 
@@ -38,12 +42,28 @@ private:
     static int handleEventNotifyDownlink(const ble_gap_event &event);
 
     static void tryConnecting(const ble_gap_event &event);
-    static bool shouldConnect(const ble_gap_event &event);
 
     static void onDiscoveryComplete(const peer *peer, int status, void *arg);
     static void subscribeToNotifications(const peer &peer);
     static void subscribe(const peer &peer, const peer_chr &characteristic);
-    static void write(uint16_t valueHandle, const std::string &value);
+    static void write(uint16_t valueHandle, std::string_view value);
+
+    static void startPolling(const peer &peer);
+    static void stopPolling();
+    static void onPollTimer(ble_npl_event *event);
+    static void read(const uint16_t *valueHandles, uint8_t count);
+    static int onReadMultipleComplete(uint16_t connectionHandle,
+                                      const ble_gatt_error *error,
+                                      ble_gatt_attr *attributes, uint8_t count,
+                                      void *arg);
+    static int onReadComplete(uint16_t connectionHandle, const ble_gatt_error *error,
+                              ble_gatt_attr *attribute, void *arg);
 };
 
+#ifdef CONFIG_EXT_CON_BENCHMARK_ENABLE
+// Microbenchmarks of the peer lookups and the notification path, run on the device by
+// `bench::Benchmark`
+void benchmark();
+#endif
+
 }  // namespace extcon::ble
\ No newline at end of file
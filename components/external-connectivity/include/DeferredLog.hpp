@@ -0,0 +1,153 @@
+#pragma once
+
+#include <esp_log.h>
+#include <sdkconfig.h>
+
+#include <MpscQueue.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+#define EXT_CON_LOG_LEVEL_LOCAL(level, tag, format, ...)                          \
+    do {                                                                          \
+        if (LOG_LOCAL_LEVEL >= level) {                                           \
+            extcon::logging::DeferredLog::write(level, tag,                       \
+                                                format __VA_OPT__(, ) __VA_ARGS__); \
+        }                                                                         \
+    } while (0)
+#else
+#define EXT_CON_LOG_LEVEL_LOCAL(level, tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL(level, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#endif
+
+// Drop-in replacements for `ESP_LOGx` on hot paths, deferred when enabled in Kconfig
+#define EXT_CON_LOGE(tag, format, ...) \
+    EXT_CON_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define EXT_CON_LOGW(tag, format, ...) \
+    EXT_CON_LOG_LEVEL_LOCAL(ESP_LOG_WARN, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define EXT_CON_LOGI(tag, format, ...) \
+    EXT_CON_LOG_LEVEL_LOCAL(ESP_LOG_INFO, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define EXT_CON_LOGD(tag, format, ...) \
+    EXT_CON_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, tag, format __VA_OPT__(, ) __VA_ARGS__)
+
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+
+namespace extcon::logging {
+
+// Log records are pushed to a bounded lock-free queue as a pointer to the format
+// string plus raw arguments, and formatted later by a low-priority task. String
+// arguments are copied, truncated to the space left in the record.
+class DeferredLog {
+public:
+    static constexpr size_t maxArguments{6};
+    static constexpr size_t stringCapacity{64};
+
+    union Argument {
+        uint64_t integer;
+        double real;
+    };
+
+    struct Record {
+        const char *tag;
+        const char *format;
+        uint32_t timestampMs;
+        esp_log_level_t level;
+        uint8_t argumentCount;
+        std::array<Argument, maxArguments> arguments;
+        std::array<char, stringCapacity> strings;
+    };
+
+    // Format string checked at compile time. `*` widths and precisions are rejected,
+    // as arguments are encoded before the format is parsed: `%.*s` would copy its
+    // string up to the NUL rather than the precision. Use `ESP_LOGx` for those.
+    class Format {
+    public:
+        template <size_t N>
+        consteval Format(const char (&format)[N]) : string{format} {
+            for (size_t i = 0; i + 1 < N; i++) {
+                if (format[i] != '%') {
+                    continue;
+                }
+                i++;
+                while (i + 1 < N &&
+                       conversionFlags.find(format[i]) != std::string_view::npos) {
+                    i++;
+                }
+                if (format[i] == '*') {
+                    asteriskIsNotSupportedInDeferredLogs();
+                }
+            }
+        }
+
+        const char *const string;
+
+    private:
+        static constexpr std::string_view conversionFlags{"-+ #0123456789.hlLzjt"};
+
+        // Not constexpr, so calling it fails the compilation with its name
+        static void asteriskIsNotSupportedInDeferredLogs();
+    };
+
+    static void start();
+
+    template <typename... Args>
+    static void write(esp_log_level_t level, const char *tag, Format format,
+                      const Args &...arguments);
+
+    static size_t format(const Record &record, char *buffer, size_t size);
+
+private:
+    template <typename T>
+    static void encode(Record &record, size_t &stringsUsed, const T &value);
+
+    // Counts the record as dropped when the queue is full
+    static void push(const Record &record);
+    static void loop(void *);
+
+    static bus::MpscQueue<Record, CONFIG_EXT_CON_DEFERRED_LOG_CAPACITY> queue;
+};
+
+template <typename... Args>
+void DeferredLog::write(esp_log_level_t level, const char *tag, Format format,
+                        const Args &...arguments) {
+    static_assert(sizeof...(Args) <= maxArguments, "Too many log arguments");
+    Record record;
+    record.tag = tag;
+    record.format = format.string;
+    record.timestampMs = esp_log_timestamp();
+    record.level = level;
+    record.argumentCount = 0;
+    [[maybe_unused]] size_t stringsUsed{0};
+    (encode(record, stringsUsed, arguments), ...);
+    push(record);
+}
+
+template <typename T>
+void DeferredLog::encode(Record &record, size_t &stringsUsed, const T &value) {
+    auto &argument{record.arguments[record.argumentCount++]};
+    if constexpr (std::is_convertible_v<const T &, const char *>) {
+        const char *string{value};
+        const auto length{
+            std::min(std::strlen(string), stringCapacity - stringsUsed - 1)};
+        std::memcpy(record.strings.data() + stringsUsed, string, length);
+        record.strings[stringsUsed + length] = '\0';
+        argument.integer = stringsUsed;
+        stringsUsed = std::min(stringsUsed + length + 1, stringCapacity - 1);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        argument.real = value;
+    } else if constexpr (std::is_pointer_v<T>) {
+        argument.integer = reinterpret_cast<uintptr_t>(value);
+    } else {
+        argument.integer = static_cast<uint64_t>(value);
+    }
+}
+
+}  // namespace extcon::logging
+
+#endif
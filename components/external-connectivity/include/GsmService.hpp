@@ -2,20 +2,26 @@
 
 #include <esp_modem_config.h>
 
+#include <Modem.hpp>
 #include <cxx_include/esp_modem_api.hpp>
 #include <cxx_include/esp_modem_dte.hpp>
 
 namespace extcon::gsm {
 
-class GsmService {
+class GsmService : public Modem {
 public:
     GsmService(const char* apn);
 
-    std::unique_ptr<esp_modem::DCE> dce;
+    bool setMode(ModemMode mode) override;
+    bool at(const std::string& command, std::string& response,
+            uint32_t timeoutMs) override;
+    bool signalQuality(int& rssi, int& ber) override;
+    bool operatorName(std::string& name, int& access) override;
 
 private:
     void configure(const char* apn);
 
+    std::unique_ptr<esp_modem::DCE> dce;
     std::shared_ptr<esp_modem::DTE> dte;
     esp_modem_dce_config dceConfig;
     esp_modem_dte_config dteConfig;
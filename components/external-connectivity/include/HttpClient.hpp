@@ -1,8 +1,11 @@
 #pragma once
 
 #include <esp_http_client.h>
+#include <sdkconfig.h>
 
+#include <array>
 #include <map>
+#include <span>
 #include <string>
 
 namespace extcon::http {
@@ -11,10 +14,19 @@ class HttpClient {
 public:
     HttpClient() = default;
 
-    esp_err_t get(std::string url);
-    esp_err_t post(std::string url, std::map<std::string, std::string> data);
+    esp_err_t get(const std::string &url);
+    esp_err_t post(const std::string &url,
+                   const std::map<std::string, std::string> &data);
+
+    // Writes the form body NUL-terminated into `buffer` as far as it fits, returns the
+    // full length of the body
+    static size_t encodeForm(const std::map<std::string, std::string> &data,
+                             std::span<char> buffer);
 
 private:
+#ifdef CONFIG_EXT_CON_STATIC_MEMORY
+    std::array<char, CONFIG_EXT_CON_HTTP_BODY_SIZE> requestBody;
+#endif
 };
 
 }  // namespace extcon::http
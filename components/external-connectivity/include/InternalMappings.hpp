@@ -20,7 +20,7 @@ const std::map<port_t, Uuid> portToUuid{
     {5, GATT_CHR_TEMPERATURE},
 };
 
-const std::array subscribableCharacteristics{
+inline constexpr std::array subscribableCharacteristics{
     GATT_CHR_CURRENT_MEASUREMENT,
     GATT_CHR_VOLTAGE_MEASUREMENT,
     GATT_CHR_PWM,
@@ -28,6 +28,22 @@ const std::array subscribableCharacteristics{
     GATT_CHR_TEMPERATURE,
 };
 
+// Read-only characteristics without notification support, polled with the given
+// sampling period in milliseconds
+const std::map<Uuid, uint32_t> pollableCharacteristics{
+    {GATT_CHR_ENGINE_SPEED, 1000},
+    {GATT_CHR_FUEL_TANK_LEVEL, 60000},
+    {GATT_CHR_BATTERY_VOLTAGE, 10000},
+    {GATT_CHR_THROTTLE_POSITION, 1000},
+};
+
+// Numeric characteristics summarized over a time window instead of being sent as is,
+// when aggregation is enabled
+inline constexpr std::array aggregatedCharacteristics{
+    GATT_CHR_CURRENT_MEASUREMENT,
+    GATT_CHR_VOLTAGE_MEASUREMENT,
+};
+
 const std::map<Uuid, std::string> uuidToType{
     {GATT_CHR_ENGINE_SPEED, "engine_speed"},
     {GATT_CHR_FUEL_TANK_LEVEL, "fuel_tank_level"},
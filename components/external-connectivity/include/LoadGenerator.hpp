@@ -0,0 +1,56 @@
+#pragma once
+
+#include <HttpClient.hpp>
+#include <Metrics.hpp>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "InternalMappings.hpp"
+#include "host/ble_hs.h"
+
+namespace extcon::bench {
+
+// Synthetic load driven from the console, to characterize a unit without a real
+// peripheral. Every run ends with a summary of throughput, drops, the uplink queue
+// high-water mark and latency percentiles.
+class LoadGenerator {
+public:
+    struct Profile {
+        uint32_t count;
+        float rateHz;
+        // Values are zero-padded to this many characters, 0 leaves them unpadded
+        size_t valueSize;
+        // Characteristics the readings cycle through
+        std::vector<Uuid> mix;
+        uint32_t drainTimeoutS;
+    };
+
+    // Parses comma-separated characteristic types, e.g. `temperature,engine_speed`
+    static std::vector<Uuid> parseMix(std::string_view types);
+    // Injects readings into the BLE uplink path on the NimBLE host task, like real
+    // notifications, then waits for the uplink queue to drain
+    static void injectReadings(const Profile &profile);
+    // Performs back-to-back GET requests
+    static void httpBurst(http::HttpClient &client, const std::string &url,
+                          uint32_t count);
+    // Publishes probe messages every `intervalMs` to a task with the priority and core
+    // of the LoRa task, to measure the latency and jitter of a handoff over the bus
+    static void busProbe(uint32_t count, uint32_t intervalMs);
+
+private:
+    static void onTimer(ble_npl_event *event);
+    // Readings lost in the LoRa or MQTT queue, on the bus or to allocation failures
+    static uint32_t droppedReadings();
+    static void printLatency(const char *name, metrics::Histogram histogram,
+                             const metrics::Metrics::Buckets &before,
+                             const char *unit = "ms");
+
+    static Profile profile;
+    static int64_t startUs;
+    static std::atomic<uint32_t> injected;
+};
+
+}  // namespace extcon::bench
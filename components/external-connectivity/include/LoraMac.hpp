@@ -0,0 +1,95 @@
+#pragma once
+
+#include <TheThingsNetwork.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace extcon::lora {
+
+// EU868 data rates DR0 (SF12) to DR5 (SF7) on 125 kHz channels
+constexpr uint8_t maxDataRate{5};
+// Maximum application payload per data rate, LoRaWAN Regional Parameters RP002
+constexpr std::array<size_t, maxDataRate + 1> maxPayloadSizes{51, 51, 51, 115, 222, 222};
+
+// Transmissions of an unacknowledged confirmed uplink by LMIC before it gives up, at a
+// lower data rate every second one (TXCONF_ATTEMPTS and DRADJUST)
+constexpr uint8_t confirmedAttempts{8};
+
+constexpr uint8_t spreadingFactor(uint8_t dataRate) {
+    return 12 - dataRate;
+}
+
+// Thin abstraction of the LoRaWAN MAC used by `LoraService`, so the uplink pipeline
+// can be exercised without a radio or a network in range.
+class LoraMac {
+public:
+    virtual ~LoraMac() = default;
+
+    virtual bool init(const std::string &devEui, const std::string &appEui,
+                      const std::string &appKey) = 0;
+    virtual bool join() = 0;
+    virtual TTNResponseCode transmitMessage(const uint8_t *payload, size_t length,
+                                            port_t port, bool confirm) = 0;
+    virtual void onMessage(TTNMessageCallback callback) = 0;
+
+    virtual void setAdrEnabled(bool enabled) = 0;
+    virtual void setDataRate(uint8_t dataRate) = 0;
+    virtual void setMaxTxPower(int8_t power) = 0;
+    // Data rate of the next uplink, not the one the radio last operated at, which is
+    // the one of a receive window after every uplink
+    virtual uint8_t dataRate() = 0;
+
+    // Restores the session, i.e. device address, session keys and frame counters,
+    // saved by `saveSession`; returns false when there is none to resume, it was
+    // joined with other keys or uplinks were sent since it was saved
+    virtual bool resumeSession() = 0;
+    // Records an uplink of the session, or saves the session to flash if `durable` is
+    // set; returns false when the MAC failed to restart after saving and has to join
+    virtual bool saveSession(bool durable) = 0;
+
+    static uint32_t airtimeMs(uint8_t dataRate, size_t payloadLength);
+    // FNV-1a hash of the keys, saved with the session to tell whether they changed
+    static uint32_t keyFingerprint(const std::string &devEui, const std::string &appEui,
+                                   const std::string &appKey);
+};
+
+// Simulates airtime, the 1% duty cycle limit and lost uplinks and acknowledgements on
+// a 125 kHz channel, with the LMIC retransmission of confirmed uplinks. ADR is not
+// simulated, the data rate only changes when set explicitly or by retransmissions,
+// and sessions are not persisted, so every boot joins.
+class SimulatedLoraMac : public LoraMac {
+public:
+    SimulatedLoraMac(uint8_t spreadingFactor, uint8_t lossPercent);
+
+    bool init(const std::string &devEui, const std::string &appEui,
+              const std::string &appKey) override;
+    bool join() override;
+    TTNResponseCode transmitMessage(const uint8_t *payload, size_t length, port_t port,
+                                    bool confirm) override;
+    void onMessage(TTNMessageCallback callback) override;
+    void setAdrEnabled(bool enabled) override;
+    void setDataRate(uint8_t dataRate) override;
+    void setMaxTxPower(int8_t power) override;
+    uint8_t dataRate() override;
+    bool resumeSession() override;
+    bool saveSession(bool durable) override;
+
+    // Data rate the radio last operated at, like `TheThingsNetwork::getSpreadingFactor`
+    uint8_t radioDataRate() const;
+
+private:
+    // EU868 default of the RX2 window, opened after every uplink
+    static constexpr uint8_t rx2DataRate{0};
+
+    bool lost() const;
+    void transmit(size_t payloadLength);
+
+    uint8_t currentDataRate;
+    uint8_t lastRadioDataRate;
+    const uint8_t lossPercent;
+    int64_t nextTransmitMs{0};
+};
+
+}  // namespace extcon::lora
@@ -3,31 +3,76 @@
 #include <TheThingsNetwork.h>
 #include <copilot/BleConsts.h>
 
-#include <queue>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+
+#include <LoraMac.hpp>
+#include <MessageBus.hpp>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 
 namespace extcon::lora {
 
+constexpr size_t uplinkQueueSize{CONFIG_EXT_CON_UPLINK_QUEUE_SIZE};
+
+enum class DataRatePolicy { NetworkAdr, Fixed, Throughput };
+
+struct DataRateStatistics {
+    uint32_t transmissions;
+    uint32_t failures;
+    uint32_t airtimeMs;
+};
+
+// Transmits the messages published to `bus::Uplink` and publishes downlinks as
+// `bus::PeripheralWrite`
 class LoraService {
 public:
-    static bool networkJoined;
-    static std::queue<std::string> uplinkQueue;
-
     static void loop(void *parameters);
-    static void onDownlinkMessage(const uint8_t *message, size_t length, port_t port);
-    static void sendUplinkMessage(const std::string &message);
 
     LoraService(std::string appEui, std::string appKey, std::string devEui);
     bool init();
     void start(bool asTask);
     void joinNetwork();
 
+    uint8_t dataRate() const;
+    size_t maxPayload() const;
+    void printStatistics() const;
+
 private:
+    static void onDownlinkMessage(const uint8_t *message, size_t length, port_t port);
+    // Wakes the loop, on the publishing task
+    static void onUplinkQueued();
+
+    static std::atomic<bool> networkJoined;
+    static bus::Mailbox<bus::Uplink, uplinkQueueSize> uplinkMailbox;
+    static std::atomic<TaskHandle_t> loopTask;
+
+    void join();
+    // Saves the session after a join or an uplink; returns false when the MAC has to
+    // join again
+    bool saveSession(bool joined);
+    void sendHealthReport();
+    std::optional<uint8_t> selectDataRate(size_t payloadLength) const;
+    TTNResponseCode transmit(std::string_view message, port_t port);
+    void adaptDataRate(uint8_t dataRate, bool acknowledged);
+
     const std::string appEui;
     const std::string appKey;
     const std::string devEui;
 
-    TheThingsNetwork ttn{};
+    std::unique_ptr<LoraMac> mac;
+    std::bitset<256> confirmedPorts;
+    uint8_t preferredDataRate;
+    uint8_t acknowledgedInRow{0};
+    uint8_t unacknowledgedInRow{0};
+    uint32_t transmissionsSinceSave{0};
+    std::array<DataRateStatistics, maxDataRate + 1> dataRateStatistics{};
 };
 
 }  // namespace extcon::lora
\ No newline at end of file
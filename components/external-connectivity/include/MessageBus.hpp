@@ -0,0 +1,145 @@
+#pragma once
+
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <DeferredLog.hpp>
+#include <Metrics.hpp>
+#include <MpscQueue.hpp>
+#include <StaticMemory.hpp>
+#include <Tracing.hpp>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "InternalMappings.hpp"
+
+namespace extcon::bus {
+
+constexpr port_t uplinkPort{1};
+
+#ifdef CONFIG_EXT_CON_STATIC_MEMORY
+constexpr size_t maxPayloadSize{CONFIG_EXT_CON_MAX_PAYLOAD_SIZE};
+using Payload = memory::FixedString<maxPayloadSize>;
+#else
+// Largest application payload at the fastest EU868 data rates
+constexpr size_t maxPayloadSize{222};
+using Payload = std::string;
+#endif
+
+// Reading for the network, from BLE or the console
+struct Uplink {
+    Payload payload;
+    port_t port{uplinkPort};
+    [[no_unique_address]] tracing::Trace trace;
+};
+
+// Value for a characteristic of the connected peripheral, from LoRa or MQTT downlinks
+struct PeripheralWrite {
+    Uuid uuid;
+    Payload value;
+};
+
+template <typename Message>
+class Subscription {
+public:
+    virtual bool deliver(const Message &message, int64_t publishedUs) = 0;
+
+protected:
+    ~Subscription() = default;
+};
+
+// Queue of one subscriber. `delivered` runs on the publishing task after a message was
+// queued, to wake the consumer. Messages published to a full mailbox are dropped,
+// logged with the subscriber `name` and counted in `drops`, the time from publishing
+// to `pop` is recorded in `latency`.
+template <typename Message, size_t Capacity>
+class Mailbox final : public Subscription<Message> {
+public:
+    Mailbox(const char *name, metrics::Counter drops, metrics::Histogram latency,
+            int64_t latencyUnitUs, void (*delivered)() = nullptr)
+        : name{name},
+          drops{drops},
+          latency{latency},
+          latencyUnitUs{latencyUnitUs},
+          delivered{delivered} {}
+
+    bool deliver(const Message &message, int64_t publishedUs) override {
+        if (!queue.push({message, publishedUs})) {
+            metrics::Metrics::increment(drops);
+            EXT_CON_LOGW("bus", "%s mailbox is full, the message was dropped", name);
+            return false;
+        }
+        if (delivered != nullptr) {
+            delivered();
+        }
+        return true;
+    }
+
+    // Consumer side only
+    bool pop(Message &message) {
+        if (!queue.pop(envelope)) {
+            return false;
+        }
+        metrics::Metrics::record(
+            latency, (esp_timer_get_time() - envelope.publishedUs) / latencyUnitUs);
+        message = std::move(envelope.message);
+        return true;
+    }
+
+    size_t size() const {
+        return queue.size();
+    }
+
+private:
+    struct Envelope {
+        Message message;
+        int64_t publishedUs;
+    };
+
+    MpscQueue<Envelope, Capacity> queue;
+    // Popped into a member, so large messages stay off the consumer's stack
+    Envelope envelope{};
+    const char *const name;
+    const metrics::Counter drops;
+    const metrics::Histogram latency;
+    const int64_t latencyUnitUs;
+    void (*const delivered)();
+};
+
+// Typed topic delivering every published message to each subscriber's mailbox.
+// Subscribers register during startup, before the first message is published.
+template <typename Message>
+class Topic {
+public:
+    static void subscribe(Subscription<Message> &subscription) {
+        const auto index{count.load(std::memory_order_relaxed)};
+        assert(index < subscriptions.size());
+        subscriptions[index] = &subscription;
+        count.store(index + 1, std::memory_order_release);
+    }
+
+    // Returns false if a subscriber dropped the message
+    static bool publish(const Message &message) {
+        const auto publishedUs{esp_timer_get_time()};
+        bool delivered{true};
+        const auto subscribers{count.load(std::memory_order_acquire)};
+        for (size_t i = 0; i < subscribers; i++) {
+            delivered &= subscriptions[i]->deliver(message, publishedUs);
+        }
+        return delivered;
+    }
+
+private:
+    static inline std::array<Subscription<Message> *, 4> subscriptions{};
+    static inline std::atomic<size_t> count{0};
+};
+
+// Prints queue latency percentiles and drops of the service mailboxes
+void printStatistics();
+
+}  // namespace extcon::bus
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace extcon::metrics {
+
+enum class Counter : uint8_t {
+    NotificationsReceived,
+    ValuesPolled,
+    UplinksQueued,
+    UplinksSent,
+    UplinksFailed,
+    UplinkQueueDrops,
+    JoinAttempts,
+    BleConnects,
+    BleDisconnects,
+    HttpRequests,
+    HttpFailures,
+    LogDrops,
+    AllocationFailures,
+    MqttReadings,
+    MqttPublishes,
+    MqttPublishFailures,
+    MqttOfflineDrops,
+    MqttBytes,
+    BusDrops,
+    MqttQueueDrops,
+    Count,
+};
+
+enum class Gauge : uint8_t {
+    UplinkQueueDepth,
+    UplinkQueueHighWater,
+    FreeHeap,
+    MinFreeHeap,
+    LoraStackHighWater,
+    BootToFirstUplinkMs,
+    Count,
+};
+
+enum class Histogram : uint8_t {
+    TransmitLatencyMs,
+    HttpLatencyMs,
+    MqttPublishLatencyMs,
+    LoraQueueLatencyMs,
+    MqttQueueLatencyMs,
+    BleWriteLatencyUs,
+    BusProbeLatencyUs,
+    Count,
+};
+
+// Process-wide registry of counters, gauges and fixed-bucket histograms. Updates are
+// single relaxed atomic operations, so they are safe to call from any task.
+class Metrics {
+public:
+    static constexpr uint8_t healthReportVersion{1};
+    static constexpr std::array<uint32_t, 10> bucketBounds{
+        10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000,
+    };
+    using Buckets = std::array<uint32_t, bucketBounds.size() + 1>;
+
+    static void increment(Counter counter, uint32_t value = 1) {
+        counters[static_cast<size_t>(counter)].fetch_add(value,
+                                                          std::memory_order_relaxed);
+    }
+
+    static void set(Gauge gauge, uint32_t value) {
+        gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    }
+
+    static void setMax(Gauge gauge, uint32_t value) {
+        auto &current{gauges[static_cast<size_t>(gauge)]};
+        uint32_t previous{current.load(std::memory_order_relaxed)};
+        while (previous < value && !current.compare_exchange_weak(
+                                       previous, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void record(Histogram histogram, uint32_t value) {
+        size_t bucket{0};
+        while (bucket < bucketBounds.size() && value >= bucketBounds[bucket]) {
+            bucket++;
+        }
+        histograms[static_cast<size_t>(histogram)][bucket].fetch_add(
+            1, std::memory_order_relaxed);
+    }
+
+    static uint32_t get(Counter counter) {
+        return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    static uint32_t get(Gauge gauge) {
+        return gauges[static_cast<size_t>(gauge)].load(std::memory_order_relaxed);
+    }
+
+    static Buckets snapshot(Histogram histogram) {
+        Buckets buckets;
+        for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+            buckets[bucket] = histograms[static_cast<size_t>(histogram)][bucket].load(
+                std::memory_order_relaxed);
+        }
+        return buckets;
+    }
+
+    // Upper bound of the bucket holding the percentile, max for the overflow bucket
+    static uint32_t percentile(const Buckets &buckets, uint32_t percent);
+    static void printPercentiles(const char *name, const Buckets &buckets,
+                                 const char *unit = "ms");
+
+    static void print();
+    // Writes the version byte followed by the health fields as little-endian 32-bit
+    // values, up to the last one that fits in `size`, returns the length written
+    static size_t healthReport(uint8_t *buffer, size_t size);
+
+private:
+    static void updateHeapGauges();
+
+    static std::array<std::atomic<uint32_t>, static_cast<size_t>(Counter::Count)>
+        counters;
+    static std::array<std::atomic<uint32_t>, static_cast<size_t>(Gauge::Count)> gauges;
+    static std::array<std::array<std::atomic<uint32_t>, bucketBounds.size() + 1>,
+                      static_cast<size_t>(Histogram::Count)>
+        histograms;
+};
+
+}  // namespace extcon::metrics
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace extcon::gsm {
+
+enum class ModemMode { Command, Data };
+
+// AT command and PPP interface of the GSM modem. `GsmService` implements it over
+// esp_modem and `ScriptedModem` with scripted responses, so the console and the
+// modem handling run without a modem attached.
+class Modem {
+public:
+    virtual ~Modem() = default;
+
+    // Dials the PPP connection in data mode, hangs up in command mode
+    virtual bool setMode(ModemMode mode) = 0;
+    // Sends an AT command in command mode, false on `ERROR` or a timeout
+    virtual bool at(const std::string &command, std::string &response,
+                    uint32_t timeoutMs) = 0;
+    virtual bool signalQuality(int &rssi, int &ber) = 0;
+    virtual bool operatorName(std::string &name, int &access) = 0;
+};
+
+}  // namespace extcon::gsm
@@ -2,15 +2,15 @@
 
 #include <esp_console.h>
 
-#include <GsmService.hpp>
 #include <HttpClient.hpp>
 #include <LoraService.hpp>
+#include <Modem.hpp>
 #include <cxx_include/esp_modem_primitives.hpp>
 #include <vector>
 
 namespace extcon::repl {
 
-using gsm::GsmService;
+using gsm::Modem;
 using http::HttpClient;
 using lora::LoraService;
 
@@ -18,8 +18,7 @@ class CommandRegistry;
 
 class ModemConsole {
 public:
-    ModemConsole(GsmService *gsmService, HttpClient *httpClient,
-                 LoraService *loraService);
+    ModemConsole(Modem *modem, HttpClient *httpClient, LoraService *loraService);
     void start();
     void waitForExit();
 
@@ -34,13 +33,13 @@ private:
 
 class CommandRegistry {
 public:
-    CommandRegistry(ModemConsole *console, GsmService *gsmService,
-                    HttpClient *httpClient, LoraService *loraService);
+    CommandRegistry(ModemConsole *console, Modem *modem, HttpClient *httpClient,
+                    LoraService *loraService);
     void registerCommands();
 
 private:
     static ModemConsole *console;
-    static GsmService *gsmService;
+    static Modem *modem;
     static HttpClient *httpClient;
     static LoraService *loraService;
     std::vector<esp_console_cmd_t> commands;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace extcon::bus {
+
+// Bounded lock-free queue for many producers and a single consumer, after Dmitry
+// Vyukov: every slot carries a sequence number telling producers and the consumer
+// whether it is free or published
+template <typename T, size_t Capacity>
+class MpscQueue {
+public:
+    MpscQueue() {
+        for (uint32_t i = 0; i < slots.size(); i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Fails when `Capacity` values are queued
+    bool push(T value) {
+        auto position{enqueuePosition.load(std::memory_order_relaxed)};
+        while (true) {
+            const auto queued{static_cast<int32_t>(
+                position - dequeuePosition.load(std::memory_order_acquire))};
+            if (queued >= static_cast<int32_t>(Capacity)) {
+                return false;
+            }
+            auto &slot{slots[position & (slots.size() - 1)]};
+            const auto sequence{slot.sequence.load(std::memory_order_acquire)};
+            const auto difference{static_cast<int32_t>(sequence - position)};
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1,
+                                                          std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side only
+    bool pop(T &value) {
+        const auto position{dequeuePosition.load(std::memory_order_relaxed)};
+        auto &slot{slots[position & (slots.size() - 1)]};
+        const auto sequence{slot.sequence.load(std::memory_order_acquire)};
+        if (static_cast<int32_t>(sequence - (position + 1)) < 0) {
+            return false;
+        }
+        value = std::move(slot.value);
+        slot.sequence.store(position + slots.size(), std::memory_order_release);
+        dequeuePosition.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate while values are pushed or popped
+    size_t size() const {
+        const auto queued{
+            static_cast<int32_t>(enqueuePosition.load(std::memory_order_relaxed) -
+                                 dequeuePosition.load(std::memory_order_relaxed))};
+        return queued > 0 ? queued : 0;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;
+        T value;
+    };
+
+    std::array<Slot, std::bit_ceil(Capacity)> slots;
+    std::atomic<uint32_t> enqueuePosition{0};
+    std::atomic<uint32_t> dequeuePosition{0};
+};
+
+}  // namespace extcon::bus
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <mqtt_client.h>
+#include <sdkconfig.h>
+
+#include <MessageBus.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#ifdef CONFIG_EXT_CON_MQTT_ENABLE
+
+namespace extcon::mqtt {
+
+// Persistent MQTT session over the GSM PPP link. Messages published to `bus::Uplink`
+// are published in batches, newline-separated, and kept in a bounded offline queue
+// while the broker cannot be reached. Messages on `<prefix>/command/<port>` are
+// published as `bus::PeripheralWrite`, like LoRa downlinks on that port.
+class MqttClient {
+public:
+    static void start();
+    static void printStatistics();
+
+private:
+    struct InFlight {
+        int messageId;
+        int64_t startUs;
+    };
+
+    static constexpr size_t mailboxSize{2 * CONFIG_EXT_CON_MQTT_BATCH_SIZE};
+
+    // Wakes the flush task once a batch is waiting, on the publishing task
+    static void onUplinkQueued();
+    static void flushTask(void *parameters);
+    // Moves uplinks from the mailbox to the offline queue
+    static void collect();
+    // Publishes the pending readings, a trailing partial batch only if `partial`
+    static void flush(bool partial);
+    static void onEvent(void *arguments, esp_event_base_t base, int32_t eventId,
+                        void *eventData);
+    static void onCommand(std::string_view topic, std::string_view data);
+
+    static esp_mqtt_client_handle_t client;
+    static TaskHandle_t flushTaskHandle;
+    static std::atomic<bool> connected;
+    static bus::Mailbox<bus::Uplink, mailboxSize> mailbox;
+    // Guards the queue of pending readings and the in-flight publishes
+    static std::mutex mutex;
+    static std::deque<std::string> pending;
+    static std::array<InFlight, 8> inFlight;
+};
+
+}  // namespace extcon::mqtt
+
+#endif
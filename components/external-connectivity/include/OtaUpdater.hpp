@@ -0,0 +1,54 @@
+#pragma once
+
+#include <esp_event.h>
+#include <esp_http_client.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <sdkconfig.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+
+namespace extcon::ota {
+
+enum class State : uint8_t { Idle, Downloading, Verifying, Done, Failed };
+
+// Streams a firmware image over HTTP into the inactive OTA partition, hashing it as
+// chunks arrive. Interrupted downloads resume with a Range request, so the server has
+// to support ranges and send a Content-Length.
+class OtaUpdater {
+public:
+    // Starts the update task; `sha256` is the expected hex digest of the image
+    static bool start(const std::string &url, const std::string &sha256);
+    static void printStatus();
+    // Confirms the running image once the modem got an IP address
+    static void confirmOnConnectivity();
+    // Confirms the running image, so the bootloader does not roll it back
+    static void confirmImage();
+
+private:
+    static void onGotIp(void *arguments, esp_event_base_t base, int32_t eventId,
+                        void *eventData);
+    static void task(void *parameters);
+    static bool update();
+    static esp_err_t download();
+    static void throttle();
+
+    static std::string url;
+    static std::array<uint8_t, 32> expectedHash;
+    static std::atomic<State> state;
+    static std::atomic<uint32_t> written;
+    static std::atomic<uint32_t> imageSize;
+    static int64_t startUs;
+    static int64_t endUs;
+    static esp_ota_handle_t handle;
+    static mbedtls_sha256_context hash;
+};
+
+}  // namespace extcon::ota
+
+#endif
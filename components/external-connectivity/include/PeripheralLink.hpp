@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string_view>
+
+#include "InternalMappings.hpp"
+
+namespace extcon::ble {
+
+// Connection to the peripheral. `BleService` implements it over NimBLE and
+// `VirtualPeripheral` with scripted values, so everything behind it runs without a BLE
+// stack. Values are forwarded with `telemetry::Pipeline::forwardValue` on the NimBLE
+// host task.
+class PeripheralLink {
+public:
+    virtual ~PeripheralLink() = default;
+
+    virtual bool init() = 0;
+    virtual void start() = 0;
+    // Writes a characteristic value, on the NimBLE host task
+    virtual void writeValue(Uuid uuid, std::string_view value) = 0;
+};
+
+}  // namespace extcon::ble
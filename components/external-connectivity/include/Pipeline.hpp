@@ -0,0 +1,37 @@
+#pragma once
+
+#include <MessageBus.hpp>
+#include <PeripheralLink.hpp>
+#include <Tracing.hpp>
+#include <array>
+#include <string_view>
+
+#include "InternalMappings.hpp"
+#include "nimble/nimble_npl.h"
+
+namespace extcon::telemetry {
+
+// Turns characteristic values into `bus::Uplink` messages, summarizing aggregated
+// characteristics when enabled, and hands `bus::PeripheralWrite` messages to the
+// peripheral link. Everything runs on the NimBLE host task.
+class Pipeline {
+public:
+    using MessageBuffer = std::array<char, bus::maxPayloadSize + 1>;
+
+    // Needs the NimBLE port to be initialized
+    static void init(ble::PeripheralLink &link);
+    static void forwardValue(Uuid uuid, std::string_view value,
+                             tracing::Trace trace = {});
+    // Formats `type=value` as a NUL-terminated string, empty if it does not fit
+    static std::string_view format(Uuid uuid, std::string_view value,
+                                   MessageBuffer &buffer);
+
+private:
+    static void uplink(Uuid uuid, std::string_view value, tracing::Trace trace);
+    static void onAggregationTimer(ble_npl_event *event);
+    static void onWriteRequests(ble_npl_event *event);
+
+    static ble::PeripheralLink *link;
+};
+
+}  // namespace extcon::telemetry
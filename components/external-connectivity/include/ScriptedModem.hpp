@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Modem.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace extcon::gsm {
+
+// Modem answering AT commands from a script, in order. Each exchange is used once and
+// a command other than the next scripted one fails. Data mode is entered by dialing
+// `ATD*99#` and left with `+++`, as on the SIM800, and AT commands fail meanwhile.
+class ScriptedModem : public Modem {
+public:
+    struct Exchange {
+        std::string command;
+        // `ERROR` fails the command, dialing only succeeds on `CONNECT`
+        std::string response;
+        uint32_t delayMs;
+    };
+
+    explicit ScriptedModem(std::vector<Exchange> script);
+
+    bool setMode(ModemMode mode) override;
+    bool at(const std::string &command, std::string &response,
+            uint32_t timeoutMs) override;
+    bool signalQuality(int &rssi, int &ber) override;
+    bool operatorName(std::string &name, int &access) override;
+
+    ModemMode mode() const;
+    // Exchanges not used yet
+    size_t pending() const;
+
+private:
+    bool exchange(const std::string &command, std::string &response,
+                  uint32_t timeoutMs);
+
+    const std::vector<Exchange> script;
+    size_t next{0};
+    ModemMode currentMode{ModemMode::Command};
+};
+
+}  // namespace extcon::gsm
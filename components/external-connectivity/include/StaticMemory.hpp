@@ -0,0 +1,36 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+namespace extcon::memory {
+
+// NUL-terminated string stored inline, truncated to `Capacity` characters.
+template <size_t Capacity>
+class FixedString {
+public:
+    FixedString() = default;
+
+    explicit FixedString(std::string_view value)
+        : size{std::min(value.size(), Capacity)} {
+        std::memcpy(buffer.data(), value.data(), size);
+        buffer[size] = '\0';
+    }
+
+    const char *c_str() const {
+        return buffer.data();
+    }
+
+    size_t length() const {
+        return size;
+    }
+
+private:
+    std::array<char, Capacity + 1> buffer{};
+    size_t size{0};
+};
+
+}  // namespace extcon::memory
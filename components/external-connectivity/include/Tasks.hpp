@@ -0,0 +1,44 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <sdkconfig.h>
+
+#include <cstdint>
+
+namespace extcon::tasks {
+
+#if CONFIG_EXT_CON_TRANSPORT_TASK_CORE < 0
+constexpr BaseType_t transportCore{tskNO_AFFINITY};
+#else
+constexpr BaseType_t transportCore{CONFIG_EXT_CON_TRANSPORT_TASK_CORE};
+#endif
+
+struct TaskConfig {
+    const char *name;
+    uint32_t stackDepth;
+    UBaseType_t priority;
+    BaseType_t core;
+};
+
+// Tasks of the services, the NimBLE host task is configured by the NimBLE component
+constexpr TaskConfig loraTask{"loraLoop", CONFIG_EXT_CON_LORA_TASK_STACK_SIZE,
+                              CONFIG_EXT_CON_LORA_TASK_PRIORITY, transportCore};
+#ifdef CONFIG_EXT_CON_MQTT_ENABLE
+constexpr TaskConfig mqttTask{"mqttFlush", CONFIG_EXT_CON_MQTT_TASK_STACK_SIZE,
+                              CONFIG_EXT_CON_MQTT_TASK_PRIORITY, transportCore};
+#endif
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+constexpr TaskConfig otaTask{"otaUpdate", CONFIG_EXT_CON_OTA_TASK_STACK_SIZE,
+                             CONFIG_EXT_CON_OTA_TASK_PRIORITY, transportCore};
+#endif
+
+inline TaskHandle_t start(const TaskConfig &config, TaskFunction_t function,
+                          void *parameters = nullptr) {
+    TaskHandle_t handle{};
+    xTaskCreatePinnedToCore(function, config.name, config.stackDepth, parameters,
+                            config.priority, &handle, config.core);
+    return handle;
+}
+
+}  // namespace extcon::tasks
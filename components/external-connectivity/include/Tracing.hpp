@@ -0,0 +1,61 @@
+#pragma once
+
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace extcon::tracing {
+
+enum class Stage : uint8_t {
+    Receive,
+    Encode,
+    Enqueue,
+    Dequeue,
+    TransmitStart,
+    TransmitDone,
+    Count,
+};
+
+#ifdef CONFIG_EXT_CON_TRACING_ENABLE
+// Timestamps of a single uplink message at every pipeline stage, in microseconds
+// since boot truncated to 32 bits; 0 marks a stage the message did not go through.
+struct Trace {
+    void stamp(Stage stage) {
+        timestampsUs[static_cast<size_t>(stage)] =
+            static_cast<uint32_t>(esp_timer_get_time()) | 1;
+    }
+
+    std::array<uint32_t, static_cast<size_t>(Stage::Count)> timestampsUs{};
+};
+#else
+struct Trace {
+    void stamp(Stage) {
+    }
+};
+#endif
+
+// Fixed-size ring of the most recent completed traces. Traces are recorded by the
+// LoRa task only; readers may observe an entry being overwritten.
+class Tracer {
+public:
+#ifdef CONFIG_EXT_CON_TRACING_ENABLE
+    static void record(const Trace &trace);
+#else
+    static void record(const Trace &) {
+    }
+#endif
+    static void printPercentiles();
+    // Prints one `trace,<sequence>,<stage timestamps...>` line per recorded trace
+    static void dump();
+
+private:
+#ifdef CONFIG_EXT_CON_TRACING_ENABLE
+    static std::array<Trace, CONFIG_EXT_CON_TRACING_RING_SIZE> ring;
+    static uint32_t recorded;
+#endif
+};
+
+}  // namespace extcon::tracing
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <TheThingsNetwork.h>
+
+#include <LoraMac.hpp>
+
+namespace extcon::lora {
+
+// LoRaWAN MAC of ttn-esp32 on an SX127x radio
+class TtnLoraMac : public LoraMac {
+public:
+    bool init(const std::string &devEui, const std::string &appEui,
+              const std::string &appKey) override;
+    bool join() override;
+    TTNResponseCode transmitMessage(const uint8_t *payload, size_t length, port_t port,
+                                    bool confirm) override;
+    void onMessage(TTNMessageCallback callback) override;
+    void setAdrEnabled(bool enabled) override;
+    void setDataRate(uint8_t dataRate) override;
+    void setMaxTxPower(int8_t power) override;
+    uint8_t dataRate() override;
+    bool resumeSession() override;
+    bool saveSession(bool durable) override;
+
+private:
+    static uint32_t savedKeyFingerprint();
+    static void saveKeyFingerprint(uint32_t fingerprint);
+
+    TheThingsNetwork ttn{};
+    uint32_t keyFingerprint{0};
+    // ttn-esp32 only reports the spreading factor of the last radio operation, mostly
+    // a receive window, so the uplink data rate is the one last set. Changes by network
+    // ADR and confirmed retransmissions are not visible.
+    uint8_t txDataRate{maxDataRate};
+};
+
+}  // namespace extcon::lora
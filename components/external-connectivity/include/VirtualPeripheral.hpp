@@ -0,0 +1,44 @@
+#pragma once
+
+#include <PeripheralLink.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "InternalMappings.hpp"
+#include "nimble/nimble_npl.h"
+
+namespace extcon::ble {
+
+// Peripheral emitting synthetic characteristic values into the uplink pipeline as if
+// they were notified, without a BLE connection. The script lists `<type>:<rate in Hz>`
+// pairs separated by commas, e.g. `current_measurement:10,temperature:0.5`. Writes
+// are only counted and logged.
+class VirtualPeripheral : public PeripheralLink {
+public:
+    explicit VirtualPeripheral(const std::string &script);
+
+    bool init() override;
+    void start() override;
+    void writeValue(Uuid uuid, std::string_view value) override;
+
+    static uint32_t emitted();
+    static uint32_t written();
+
+private:
+    struct Stream {
+        Uuid uuid;
+        uint32_t periodMs;
+        int64_t nextDueMs;
+        uint32_t sequence;
+    };
+
+    static void loop(void *);
+    static void onTimer(ble_npl_event *event);
+
+    static std::vector<Stream> streams;
+    static std::atomic<uint32_t> emittedValues;
+    static std::atomic<uint32_t> writtenValues;
+};
+
+}  // namespace extcon::ble
@@ -0,0 +1,71 @@
+#include "Aggregator.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace extcon::telemetry {
+
+Aggregator::Aggregator(uint32_t windowMs, bool withVariance, Sink sink)
+    : windowMs{windowMs}, withVariance{withVariance}, sink{sink} {
+    std::transform(aggregatedCharacteristics.begin(), aggregatedCharacteristics.end(),
+                   series.begin(), [](Uuid uuid) { return Series{.uuid = uuid}; });
+}
+
+bool Aggregator::add(Uuid uuid, float value, int64_t nowMs) {
+    const auto entry{
+        std::find_if(series.begin(), series.end(), [uuid](const auto &candidate) {
+            return candidate.uuid == uuid;
+        })};
+    if (entry == series.end()) {
+        return false;
+    }
+
+    const auto window{nowMs / windowMs};
+    if (entry->count > 0 && entry->window != window) {
+        emit(*entry);
+    }
+    if (entry->count == 0) {
+        entry->window = window;
+        entry->min = value;
+        entry->max = value;
+    }
+
+    // Welford's online algorithm keeps the mean and variance numerically stable
+    entry->count++;
+    entry->min = std::min(entry->min, value);
+    entry->max = std::max(entry->max, value);
+    entry->last = value;
+    const double delta{value - entry->mean};
+    entry->mean += delta / entry->count;
+    entry->m2 += delta * (value - entry->mean);
+    if (entry->count == maxSamples) {
+        emit(*entry);
+    }
+    return true;
+}
+
+void Aggregator::flush(int64_t nowMs) {
+    const auto window{nowMs / windowMs};
+    for (auto &entry : series) {
+        if (entry.count > 0 && entry.window != window) {
+            emit(entry);
+        }
+    }
+}
+
+void Aggregator::emit(Series &series) {
+    char summary[maxSummaryLength];
+    auto end{std::format_to_n(summary, sizeof(summary), "{:.3g}/{:.3g}/{:.3g}/{:.3g}/{}",
+                              series.min, series.max, series.mean, series.last,
+                              series.count)
+                 .out};
+    if (withVariance) {
+        end = std::format_to_n(end, summary + sizeof(summary) - end, "/{:.2g}",
+                               series.m2 / series.count)
+                  .out;
+    }
+    series = Series{.uuid = series.uuid};
+    sink(series.uuid, {summary, static_cast<size_t>(end - summary)});
+}
+
+}  // namespace extcon::telemetry
@@ -0,0 +1,95 @@
+#include "Benchmark.hpp"
+
+#include <esp_app_desc.h>
+#include <sdkconfig.h>
+
+#include <Aggregator.hpp>
+#include <HttpClient.hpp>
+#include <InternalMappings.hpp>
+#include <LoraService.hpp>
+#include <MessageBus.hpp>
+#include <Pipeline.hpp>
+#include <cinttypes>
+#include <cstdio>
+
+#ifdef CONFIG_EXT_CON_BENCHMARK_ENABLE
+
+#ifndef CONFIG_IDF_TARGET_LINUX
+#include <BleService.hpp>
+#include <Tasks.hpp>
+#endif
+
+namespace extcon::bench {
+
+void Benchmark::runAll() {
+#ifdef CONFIG_IDF_TARGET_LINUX
+    runBenchmarks();
+#else
+    // The cycle counter is per core, so the benchmarks run in a task pinned to the
+    // current core at the priority of the console task, which waits for them
+    tasks::start({"bench", 4096, uxTaskPriorityGet(nullptr), esp_cpu_get_core_id()},
+                 runPinned, xTaskGetCurrentTaskHandle());
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#endif
+}
+
+#ifndef CONFIG_IDF_TARGET_LINUX
+void Benchmark::runPinned(void *caller) {
+    ble::benchmark();
+    runBenchmarks();
+    xTaskNotifyGive(static_cast<TaskHandle_t>(caller));
+    vTaskDelete(nullptr);
+}
+#endif
+
+void Benchmark::runBenchmarks() {
+    constexpr char value[]{"12.34"};
+    telemetry::Pipeline::MessageBuffer message;
+    run("pipeline_format", 1000, [&] {
+        return telemetry::Pipeline::format(GATT_CHR_CURRENT_MEASUREMENT, value, message)
+            .size();
+    });
+
+    // Static, as the fixed-capacity queue is too large for the task stack
+    static bus::MpscQueue<bus::Uplink, lora::uplinkQueueSize> uplinkQueue;
+    static bus::Uplink uplink;
+    const std::string payload{"current_measurement=12.34"};
+    run("uplink_queue_push_pop", 1000, [&] {
+        uplinkQueue.push({bus::Payload{payload}});
+        return uplinkQueue.pop(uplink);
+    });
+
+    run("uuid_to_type", 1000, [] {
+        return uuidToType.find(GATT_CHR_VOLTAGE_MEASUREMENT)->second.size();
+    });
+    run("port_to_uuid", 1000, [] { return portToUuid.find(5)->second; });
+
+    const std::map<std::string, std::string> form{
+        {"type", "current_measurement"},
+        {"value", "12.34"},
+        {"device", "c8:c9:a3:c6:5f:8a"},
+    };
+    char body[128];
+    run("http_form_body", 1000,
+        [&] { return http::HttpClient::encodeForm(form, body); });
+
+    telemetry::Aggregator aggregator{60000, true, [](Uuid, std::string_view) {}};
+    int64_t nowMs{0};
+    run("aggregator_add", 1000, [&] {
+        return aggregator.add(aggregatedCharacteristics.front(), 12.34f, nowMs++);
+    });
+}
+
+void Benchmark::report(const char *name, uint32_t iterations, uint32_t cycles,
+                       int64_t elapsedUs) {
+    printf(
+        "{\"version\":\"%s\",\"benchmark\":\"%s\",\"iterations\":%" PRIu32
+        ",\"cycles_per_op\":%.1f,\"ns_per_op\":%.1f}\n",
+        esp_app_get_description()->version, name, iterations,
+        static_cast<double>(cycles) / iterations,
+        static_cast<double>(elapsedUs) * 1000 / iterations);
+}
+
+}  // namespace extcon::bench
+
+#endif
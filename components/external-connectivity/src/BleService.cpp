@@ -3,15 +3,22 @@
 #include <copilot/BleConsts.h>
 #include <sys/queue.h>
 
+#include <Benchmark.hpp>
+#include <DeferredLog.hpp>
 #include <InternalMappings.hpp>
-#include <LoraService.hpp>
+#include <Metrics.hpp>
+#include <Pipeline.hpp>
 #include <algorithm>
-#include <format>
-#include <string>
+#include <array>
+#include <cstdio>
+#include <numeric>
+#include <string_view>
+#include <vector>
 
 #include "esp_central.h"
 #include "esp_err.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "host/ble_gap.h"
 #include "host/ble_gatt.h"
 #include "host/ble_hs.h"
@@ -29,21 +36,51 @@
 namespace {
 
 using extcon::Uuid;
+using extcon::metrics::Counter;
+using extcon::metrics::Metrics;
+using extcon::telemetry::Pipeline;
+using extcon::tracing::Stage;
+using extcon::tracing::Trace;
 
 constexpr auto logTag{"ble"};
 constexpr auto deviceName{"ext-con"};
 uint8_t addressType;
 
-constexpr std::string to_string(const ble_addr_t &address) {
-    return std::format("{:02X}:{:02X}:{:02X}:{:02X}:{:02X}:{:02X}", address.val[5],
-                       address.val[4], address.val[3], address.val[2], address.val[1],
-                       address.val[0]);
+struct PollSlot {
+    Uuid uuid;
+    uint16_t valueHandle;
+    uint32_t periodMs;
+    int64_t nextDueMs;
+};
+
+std::vector<PollSlot> pollSlots;
+std::vector<uint16_t> dueHandles;
+uint32_t pollTickMs;
+ble_npl_callout pollCallout;
+#if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+// Handles of the outstanding batched read, read one by one again if it fails
+std::array<uint16_t, MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS)> batchHandles;
+uint8_t batchCount{0};
+#endif
+
+// Fixed-size buffers keep the notification and uplink paths free of heap allocations
+using ValueBuffer = std::array<char, 64>;
+
+ble_addr_t parseAddress(const char *string) {
+    ble_addr_t address{};
+    sscanf(string, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &address.val[5], &address.val[4],
+           &address.val[3], &address.val[2], &address.val[1], &address.val[0]);
+    return address;
 }
 
-std::string to_upper(const std::string &str) {
-    std::string upperStr{str};
-    std::transform(upperStr.begin(), upperStr.end(), upperStr.begin(), ::toupper);
-    return upperStr;
+const ble_addr_t targetAddress{parseAddress(CONFIG_EXT_CON_PERIPHERAL_ADDRESS)};
+
+// Copies the buffer as a NUL-terminated string, truncated to fit
+std::string_view copyValue(const os_mbuf &buffer, ValueBuffer &value) {
+    const auto length{std::min<size_t>(OS_MBUF_PKTLEN(&buffer), value.size() - 1)};
+    os_mbuf_copydata(&buffer, 0, length, value.data());
+    value[length] = '\0';
+    return {value.data(), length};
 }
 
 peer_chr *getCharacteristic(const peer &peer, Uuid uuid) {
@@ -72,6 +109,30 @@ Uuid getUuid(const peer &peer, uint16_t attributeHandle) {
     return 0;
 }
 
+bool shouldConnect(const ble_gap_event &event) {
+    const auto &advertisingReport{event.disc};
+
+    if (advertisingReport.event_type != BLE_HCI_ADV_RPT_EVTYPE_ADV_IND &&
+        advertisingReport.event_type != BLE_HCI_ADV_RPT_EVTYPE_DIR_IND) {
+        return false;
+    }
+
+    ble_hs_adv_fields fields;
+    int result{ble_hs_adv_parse_fields(&fields, advertisingReport.data,
+                                       advertisingReport.length_data)};
+    if (result != 0) {
+        ESP_LOGW(logTag, "Advertisement parse failed, result: %d", result);
+        return false;
+    }
+
+    const auto &address{advertisingReport.addr.val};
+    if (!std::equal(std::begin(address), std::end(address), targetAddress.val)) {
+        return false;
+    }
+
+    return true;
+}
+
 void debugPrint(const peer *peer) {
     peer_svc *service;
     peer_chr *characteristic;
@@ -106,19 +167,6 @@ namespace extcon::ble {
 
 const peer *BleService::connectedPeer = nullptr;
 
-void BleService::writeValue(Uuid uuid, const std::string &value) {
-    if (connectedPeer == nullptr) {
-        ESP_LOGW(logTag, "No connected peer");
-        return;
-    }
-    auto characteristic{getCharacteristic(*connectedPeer, uuid)};
-    if (characteristic == nullptr) {
-        ESP_LOGW(logTag, "Characteristic not found: 0x%02X", uuid);
-        return;
-    }
-    write(characteristic->chr.val_handle, value);
-}
-
 bool BleService::init() {
     ESP_ERROR_CHECK(nimble_port_init());
 
@@ -132,6 +180,8 @@ bool BleService::init() {
     constexpr int maxDefinitions{64};
     ESP_ERROR_CHECK(peer_init(maxPeers, maxDefinitions, maxDefinitions, maxDefinitions));
 
+    ble_npl_callout_init(&pollCallout, nimble_port_get_dflt_eventq(), onPollTimer,
+                         nullptr);
     return true;
 }
 
@@ -199,13 +249,16 @@ int BleService::onEvent(ble_gap_event *event, void *arg) {
 }
 
 int BleService::handleEventDiscovery(const ble_gap_event &event) {
-    ESP_LOGD(logTag, "Found address: %s", to_string(event.disc.addr).c_str());
+    const auto &address{event.disc.addr.val};
+    EXT_CON_LOGD(logTag, "Found address: %02X:%02X:%02X:%02X:%02X:%02X", address[5],
+                 address[4], address[3], address[2], address[1], address[0]);
     tryConnecting(event);
     return 0;
 }
 
 int BleService::handleEventConnect(const ble_gap_event &event) {
     if (event.connect.status == 0) {
+        Metrics::increment(Counter::BleConnects);
         int result{peer_add(event.connect.conn_handle)};
         if (result != 0) {
             ESP_LOGE(logTag, "Failed to add peer, result: %d", result);
@@ -221,16 +274,25 @@ int BleService::handleEventConnect(const ble_gap_event &event) {
 
 int BleService::handleEventDisconnect(const ble_gap_event &event) {
     ESP_LOGI(logTag, "Disconnected");
+    Metrics::increment(Counter::BleDisconnects);
+    stopPolling();
+    connectedPeer = nullptr;
     peer_delete(event.disconnect.conn.conn_handle);
     scanDevices();
     return 0;
 }
 
 int BleService::handleEventNotifyDownlink(const ble_gap_event &event) {
-    char buffer[OS_MBUF_PKTLEN(event.notify_rx.om) + 1];
-    os_mbuf_copydata(event.notify_rx.om, 0, sizeof(buffer), buffer);
-    buffer[sizeof(buffer)] = '\0';
-    ESP_LOGD(logTag, "Notification received: %s", buffer);
+    Trace trace{};
+    trace.stamp(Stage::Receive);
+    Metrics::increment(Counter::NotificationsReceived);
+    ValueBuffer buffer;
+    const auto value{copyValue(*event.notify_rx.om, buffer)};
+    EXT_CON_LOGD(logTag, "Notification received: %s", value.data());
+    // Notifications may arrive before service discovery completed
+    if (connectedPeer == nullptr) {
+        return 0;
+    }
 
     const auto uuid{getUuid(*connectedPeer, event.notify_rx.attr_handle)};
     if (uuid == 0) {
@@ -238,15 +300,7 @@ int BleService::handleEventNotifyDownlink(const ble_gap_event &event) {
                  event.notify_rx.attr_handle);
         return 0;
     }
-    if (uuidToType.find(uuid) == uuidToType.end()) {
-        ESP_LOGW(logTag, "UUID not found in mapping: 0x%02X", uuid);
-        return 0;
-    }
-    const auto type{uuidToType.at(uuid)};
-    const auto value{std::string{buffer}};
-    const auto message{std::format("{}={}", type, value)};
-    ESP_LOGD(logTag, "Sending message: %s", message.c_str());
-    lora::LoraService::sendUplinkMessage(message);
+    Pipeline::forwardValue(uuid, value, trace);
 
     return 0;
 }
@@ -265,31 +319,6 @@ void BleService::tryConnecting(const ble_gap_event &event) {
                                     nullptr, onEvent, nullptr));
 }
 
-bool BleService::shouldConnect(const ble_gap_event &event) {
-    const auto &advertisingReport{event.disc};
-
-    if (advertisingReport.event_type != BLE_HCI_ADV_RPT_EVTYPE_ADV_IND &&
-        advertisingReport.event_type != BLE_HCI_ADV_RPT_EVTYPE_DIR_IND) {
-        return false;
-    }
-
-    ble_hs_adv_fields fields;
-    int result{ble_hs_adv_parse_fields(&fields, advertisingReport.data,
-                                       advertisingReport.length_data)};
-    if (result != 0) {
-        ESP_LOGW(logTag, "Advertisement parse failed, result: %d", result);
-        return false;
-    }
-
-    const auto targetAddress{to_upper(CONFIG_EXT_CON_PERIPHERAL_ADDRESS)};
-    const auto address{to_string(advertisingReport.addr)};
-    if (address != targetAddress) {
-        return false;
-    }
-
-    return true;
-}
-
 void BleService::onDiscoveryComplete(const peer *peer, int status, void *arg) {
     if (status != 0) {
         ESP_LOGE(logTag, "Discovery failed, status: %d", status);
@@ -302,6 +331,9 @@ void BleService::onDiscoveryComplete(const peer *peer, int status, void *arg) {
 
     debugPrint(connectedPeer);
     subscribeToNotifications(*connectedPeer);
+#ifdef CONFIG_EXT_CON_BLE_POLL_ENABLE
+    startPolling(*connectedPeer);
+#endif
 }
 
 void BleService::subscribeToNotifications(const peer &peer) {
@@ -319,16 +351,28 @@ void BleService::subscribe(const peer &peer, const peer_chr &characteristic) {
     const auto ccdDescriptorHandle{characteristic.dscs.slh_first->dsc.handle};
     constexpr uint8_t subscribeValue[]{0x01, 0x00};
     write(ccdDescriptorHandle,
-          std::string{reinterpret_cast<const char *>(subscribeValue),
-                      sizeof(subscribeValue)});
+          {reinterpret_cast<const char *>(subscribeValue), sizeof(subscribeValue)});
 }
 
-void BleService::write(uint16_t valueHandle, const std::string &value) {
+void BleService::writeValue(Uuid uuid, std::string_view value) {
     if (connectedPeer == nullptr) {
         ESP_LOGW(logTag, "No connected peer");
         return;
     }
-    ESP_LOGD(logTag, "Writing value: %s", value.c_str());
+    const auto characteristic{getCharacteristic(*connectedPeer, uuid)};
+    if (characteristic == nullptr) {
+        ESP_LOGW(logTag, "Characteristic not found: 0x%02X", uuid);
+        return;
+    }
+    write(characteristic->chr.val_handle, value);
+}
+
+void BleService::write(uint16_t valueHandle, std::string_view value) {
+    if (connectedPeer == nullptr) {
+        ESP_LOGW(logTag, "No connected peer");
+        return;
+    }
+    EXT_CON_LOGD(logTag, "Writing %d bytes to handle %d", value.size(), valueHandle);
     auto result{ble_gattc_write_flat(connectedPeer->conn_handle, valueHandle,
                                      value.data(), value.size(), nullptr, nullptr)};
     if (result != 0) {
@@ -336,4 +380,195 @@ void BleService::write(uint16_t valueHandle, const std::string &value) {
     }
 }
 
+void BleService::startPolling(const peer &peer) {
+    pollSlots.clear();
+    pollTickMs = 0;
+    const auto nowMs{esp_timer_get_time() / 1000};
+    for (const auto &[uuid, periodMs] : pollableCharacteristics) {
+        const auto characteristic{getCharacteristic(peer, uuid)};
+        if (characteristic == nullptr) {
+            ESP_LOGW(logTag, "Pollable characteristic not found: 0x%02X", uuid);
+            continue;
+        }
+        if ((characteristic->chr.properties & BLE_GATT_CHR_PROP_READ) == 0) {
+            ESP_LOGW(logTag, "Pollable characteristic not readable: 0x%02X", uuid);
+            continue;
+        }
+        pollSlots.push_back({uuid, characteristic->chr.val_handle, periodMs, nowMs});
+        pollTickMs = std::gcd(pollTickMs, periodMs);
+    }
+    if (pollSlots.empty()) {
+        return;
+    }
+    dueHandles.reserve(pollSlots.size());
+
+    // Align the scheduler tick to the connection interval so that reads which fall
+    // due together are issued in the same tick and share radio events
+    ble_gap_conn_desc descriptor;
+    if (ble_gap_conn_find(peer.conn_handle, &descriptor) == 0) {
+        // Connection interval is expressed in units of 1.25 ms
+        const uint32_t intervalMs{std::max(1u, descriptor.conn_itvl * 5u / 4u)};
+        pollTickMs = (pollTickMs + intervalMs - 1) / intervalMs * intervalMs;
+    }
+
+    ESP_LOGI(logTag, "Polling %d characteristics, tick: %lu ms", pollSlots.size(),
+             pollTickMs);
+    ble_npl_callout_reset(&pollCallout, ble_npl_time_ms_to_ticks32(pollTickMs));
+}
+
+void BleService::stopPolling() {
+    ble_npl_callout_stop(&pollCallout);
+    pollSlots.clear();
+#if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+    batchCount = 0;
+#endif
+}
+
+void BleService::onPollTimer(ble_npl_event *) {
+    if (connectedPeer == nullptr || pollSlots.empty()) {
+        return;
+    }
+
+    const auto nowMs{esp_timer_get_time() / 1000};
+    dueHandles.clear();
+    for (auto &slot : pollSlots) {
+        if (slot.nextDueMs > nowMs) {
+            continue;
+        }
+        dueHandles.push_back(slot.valueHandle);
+        slot.nextDueMs += slot.periodMs;
+        if (slot.nextDueMs <= nowMs) {
+            slot.nextDueMs = nowMs + slot.periodMs;
+        }
+    }
+    if (!dueHandles.empty()) {
+        read(dueHandles.data(), dueHandles.size());
+    }
+
+    ble_npl_callout_reset(&pollCallout, ble_npl_time_ms_to_ticks32(pollTickMs));
+}
+
+void BleService::read(const uint16_t *valueHandles, uint8_t count) {
+#if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+    // Values are variable-length strings, so the plain Read Multiple request cannot
+    // be used as its response does not delimit the values
+    // Values falling due while a batch is outstanding are read one by one
+    if (count > 1 && count <= batchHandles.size() && batchCount == 0) {
+        const auto result{ble_gattc_read_mult_var(connectedPeer->conn_handle,
+                                                  valueHandles, count,
+                                                  onReadMultipleComplete, nullptr)};
+        if (result == 0) {
+            std::copy_n(valueHandles, count, batchHandles.begin());
+            batchCount = count;
+            return;
+        }
+        ESP_LOGD(logTag, "Read multiple failed, result: %d", result);
+    }
+#endif
+    for (uint8_t i = 0; i < count; i++) {
+        const auto result{ble_gattc_read(connectedPeer->conn_handle, valueHandles[i],
+                                         onReadComplete, nullptr)};
+        if (result != 0) {
+            ESP_LOGE(logTag, "Failed to read value, result: %d", result);
+        }
+    }
+}
+
+#if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+int BleService::onReadMultipleComplete(uint16_t, const ble_gatt_error *error,
+                                       ble_gatt_attr *attributes, uint8_t count,
+                                       void *) {
+    const auto batchSize{batchCount};
+    batchCount = 0;
+    if (error->status != 0) {
+        ESP_LOGW(logTag, "Read multiple failed, status: %d, reading %d values singly",
+                 error->status, batchSize);
+        for (uint8_t i = 0; i < batchSize && connectedPeer != nullptr; i++) {
+            const auto result{ble_gattc_read(connectedPeer->conn_handle, batchHandles[i],
+                                             onReadComplete, nullptr)};
+            if (result != 0) {
+                ESP_LOGE(logTag, "Failed to read value, result: %d", result);
+            }
+        }
+        return 0;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        onReadComplete(0, error, &attributes[i], nullptr);
+    }
+    return 0;
+}
+#endif
+
+int BleService::onReadComplete(uint16_t, const ble_gatt_error *error,
+                               ble_gatt_attr *attribute, void *) {
+    if (error->status != 0 || attribute == nullptr) {
+        ESP_LOGW(logTag, "Read failed, status: %d", error->status);
+        return 0;
+    }
+    if (connectedPeer == nullptr) {
+        return 0;
+    }
+
+    Trace trace{};
+    trace.stamp(Stage::Receive);
+    ValueBuffer buffer;
+    const auto value{copyValue(*attribute->om, buffer)};
+    EXT_CON_LOGD(logTag, "Value read: %s", value.data());
+    Metrics::increment(Counter::ValuesPolled);
+    Pipeline::forwardValue(getUuid(*connectedPeer, attribute->handle), value, trace);
+    return 0;
+}
+
+#ifdef CONFIG_EXT_CON_BENCHMARK_ENABLE
+void benchmark() {
+    // Synthetic peer with a single service holding every mapped characteristic; the
+    // characteristic inserted first ends up last in the list and is the worst case
+    peer benchmarkPeer{};
+    peer_svc service{};
+    SLIST_INIT(&benchmarkPeer.svcs);
+    SLIST_INIT(&service.chrs);
+    SLIST_INSERT_HEAD(&benchmarkPeer.svcs, &service, next);
+    std::vector<peer_chr> characteristics(uuidToType.size());
+    uint16_t valueHandle{1};
+    auto characteristic{characteristics.begin()};
+    for (const auto &[uuid, type] : uuidToType) {
+        characteristic->chr.uuid.u16.u.type = BLE_UUID_TYPE_16;
+        characteristic->chr.uuid.u16.value = uuid;
+        characteristic->chr.val_handle = valueHandle++;
+        SLIST_INIT(&characteristic->dscs);
+        SLIST_INSERT_HEAD(&service.chrs, &*characteristic, next);
+        characteristic++;
+    }
+    const auto worstUuid{uuidToType.begin()->first};
+    constexpr uint16_t worstHandle{1};
+
+    bench::Benchmark::run("get_characteristic", 1000, [&] {
+        return getCharacteristic(benchmarkPeer, worstUuid);
+    });
+    bench::Benchmark::run("get_uuid", 1000,
+                          [&] { return getUuid(benchmarkPeer, worstHandle); });
+
+    constexpr char notification[]{"12.34"};
+    auto buffer{ble_hs_mbuf_from_flat(notification, sizeof(notification) - 1)};
+    bench::Benchmark::run("notify_parse_format", 1000, [&] {
+        ValueBuffer valueBuffer;
+        Pipeline::MessageBuffer messageBuffer;
+        const auto value{copyValue(*buffer, valueBuffer)};
+        const auto uuid{getUuid(benchmarkPeer, worstHandle)};
+        return Pipeline::format(uuid, value, messageBuffer).size();
+    });
+    os_mbuf_free_chain(buffer);
+
+    constexpr uint8_t advertisingData[]{0x02, BLE_HS_ADV_TYPE_FLAGS,
+                                        BLE_HS_ADV_F_DISC_GEN};
+    ble_gap_event event{};
+    event.type = BLE_GAP_EVENT_DISC;
+    event.disc.event_type = BLE_HCI_ADV_RPT_EVTYPE_ADV_IND;
+    event.disc.addr = {BLE_ADDR_PUBLIC, {0x8a, 0x5f, 0xc6, 0xa3, 0xc9, 0xc8}};
+    event.disc.data = advertisingData;
+    event.disc.length_data = sizeof(advertisingData);
+    bench::Benchmark::run("should_connect", 1000, [&] { return shouldConnect(event); });
+}
+#endif
+
 }  // namespace extcon::ble
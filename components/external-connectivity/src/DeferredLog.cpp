@@ -0,0 +1,98 @@
+#include "DeferredLog.hpp"
+
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <Metrics.hpp>
+#include <cstdio>
+
+namespace extcon::logging {
+
+decltype(DeferredLog::queue) DeferredLog::queue{};
+
+void DeferredLog::start() {
+    constexpr uint32_t stackDepth{3072};
+    xTaskCreate(loop, "deferredLog", stackDepth, nullptr, tskIDLE_PRIORITY + 1, nullptr);
+}
+
+void DeferredLog::push(const Record &record) {
+    if (!queue.push(record)) {
+        metrics::Metrics::increment(metrics::Counter::LogDrops);
+    }
+}
+
+void DeferredLog::loop(void *) {
+    constexpr char levelLetters[]{"NEWIDV"};
+    Record record;
+    char buffer[256];
+    while (true) {
+        while (queue.pop(record)) {
+            format(record, buffer, sizeof(buffer));
+            esp_log_write(record.level, record.tag, "%c (%lu) %s: %s\n",
+                          levelLetters[record.level], record.timestampMs, record.tag,
+                          buffer);
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+size_t DeferredLog::format(const Record &record, char *buffer, size_t size) {
+    size_t length{0};
+    uint8_t argumentIndex{0};
+    const auto append{[&](const char *specification, auto value) {
+        const auto written{
+            snprintf(buffer + length, size - length, specification, value)};
+        if (written > 0) {
+            length = std::min(length + written, size - 1);
+        }
+    }};
+
+    const char *cursor{record.format};
+    while (*cursor != '\0' && length + 1 < size) {
+        if (*cursor != '%' || cursor[1] == '%') {
+            buffer[length++] = *cursor;
+            cursor += *cursor == '%' ? 2 : 1;
+            continue;
+        }
+
+        // Format each conversion on its own, with the argument type it expects
+        const char *start{cursor++};
+        while (*cursor != '\0' && std::strchr("-+ #0123456789.hlLzjt", *cursor)) {
+            cursor++;
+        }
+        if (*cursor == '\0' || argumentIndex >= record.argumentCount) {
+            break;
+        }
+        const char conversion{*cursor++};
+        char specification[16];
+        const auto specificationLength{
+            std::min<size_t>(cursor - start, sizeof(specification) - 1)};
+        std::memcpy(specification, start, specificationLength);
+        specification[specificationLength] = '\0';
+
+        const auto &argument{record.arguments[argumentIndex++]};
+        if (conversion == 's') {
+            append(specification, record.strings.data() + argument.integer);
+        } else if (std::strchr("fFeEgGaA", conversion)) {
+            append(specification, argument.real);
+        } else if (conversion == 'p') {
+            const auto address{static_cast<uintptr_t>(argument.integer)};
+            append(specification, reinterpret_cast<void *>(address));
+        } else if (std::strstr(specification, "ll") || std::strchr(specification, 'j')) {
+            append(specification, static_cast<long long>(argument.integer));
+        } else if (std::strchr(specification, 'l') || std::strchr(specification, 'z') ||
+                   std::strchr(specification, 't')) {
+            append(specification, static_cast<long>(argument.integer));
+        } else {
+            append(specification, static_cast<int>(argument.integer));
+        }
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+}  // namespace extcon::logging
+
+#endif
@@ -15,6 +15,24 @@ GsmService::GsmService(const char* apn) {
     assert(dce != nullptr);
 }
 
+bool GsmService::setMode(ModemMode mode) {
+    return dce->set_mode(mode == ModemMode::Data ? esp_modem::modem_mode::DATA_MODE
+                                                 : esp_modem::modem_mode::COMMAND_MODE);
+}
+
+bool GsmService::at(const std::string& command, std::string& response,
+                    uint32_t timeoutMs) {
+    return dce->at(command, response, timeoutMs) == esp_modem::command_result::OK;
+}
+
+bool GsmService::signalQuality(int& rssi, int& ber) {
+    return dce->get_signal_quality(rssi, ber) == esp_modem::command_result::OK;
+}
+
+bool GsmService::operatorName(std::string& name, int& access) {
+    return dce->get_operator_name(name, access) == esp_modem::command_result::OK;
+}
+
 void GsmService::configure(const char* apn) {
     dceConfig = {.apn = apn};
     netifConfig = ESP_NETIF_DEFAULT_PPP();
@@ -1,93 +1,137 @@
 #include "HttpClient.hpp"
 
 #include <esp_log.h>
+#include <esp_timer.h>
+
+#include <DeferredLog.hpp>
+#include <Metrics.hpp>
+#include <vector>
 
 namespace extcon::http {
 
+using metrics::Counter;
+using metrics::Histogram;
+using metrics::Metrics;
+
 constexpr auto logTag = "http";
 
 esp_err_t handleHttpEvent(esp_http_client_event_t *event) {
     switch (event->event_id) {
         case HTTP_EVENT_ERROR:
-            ESP_LOGD(logTag, "HTTP_EVENT_ERROR");
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_ERROR");
             break;
         case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGD(logTag, "HTTP_EVENT_ON_CONNECTED");
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_ON_CONNECTED");
             break;
         case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGD(logTag, "HTTP_EVENT_HEADER_SENT");
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_HEADER:
-            ESP_LOGD(logTag, "HTTP_EVENT_ON_HEADER");
-            ESP_LOGD(logTag, "%s: %s", event->header_key, event->header_value);
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_ON_HEADER");
+            EXT_CON_LOGD(logTag, "%s: %s", event->header_key, event->header_value);
             break;
         case HTTP_EVENT_ON_DATA:
-            ESP_LOGD(logTag, "HTTP_EVENT_ON_DATA");
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_ON_DATA");
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+            EXT_CON_LOGD(logTag, "Received %d bytes", event->data_len);
+#else
             ESP_LOG_BUFFER_HEXDUMP(logTag, event->data, event->data_len, ESP_LOG_INFO);
+#endif
             break;
         case HTTP_EVENT_ON_FINISH:
-            ESP_LOGD(logTag, "HTTP_EVENT_ON_FINISH");
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_ON_FINISH");
             break;
         case HTTP_EVENT_DISCONNECTED:
-            ESP_LOGD(logTag, "HTTP_EVENT_DISCONNECTED");
+            EXT_CON_LOGD(logTag, "HTTP_EVENT_DISCONNECTED");
             break;
         default:
-            ESP_LOGD(logTag, "Unhandled event %u", event->event_id);
+            EXT_CON_LOGD(logTag, "Unhandled event %u", event->event_id);
             break;
     }
     return ESP_OK;
 }
 
-esp_err_t HttpClient::get(std::string url) {
+esp_err_t HttpClient::get(const std::string &url) {
     esp_http_client_config_t config{
         .url = url.c_str(),
         .method = HTTP_METHOD_GET,
         .event_handler = handleHttpEvent,
     };
     auto client = esp_http_client_init(&config);
+    if (client == nullptr) {
+        ESP_LOGE(logTag, "Failed to initialize the HTTP client");
+        Metrics::increment(Counter::HttpFailures);
+        return ESP_FAIL;
+    }
+    Metrics::increment(Counter::HttpRequests);
+    const auto startUs{esp_timer_get_time()};
     auto result = esp_http_client_perform(client);
+    Metrics::record(Histogram::HttpLatencyMs, (esp_timer_get_time() - startUs) / 1000);
     if (result != ESP_OK) {
+        Metrics::increment(Counter::HttpFailures);
         ESP_LOGE(logTag, "Failed to perform HTTP request: %s", esp_err_to_name(result));
+        esp_http_client_cleanup(client);
         return result;
     }
 
     auto contentLength = esp_http_client_get_content_length(client);
     auto statusCode = esp_http_client_get_status_code(client);
-    ESP_LOGI(logTag, "GET request completed, status code: %d, content length: %lld",
-             statusCode, contentLength);
+    EXT_CON_LOGI(logTag, "GET request completed, status code: %d, content length: %lld",
+                 statusCode, contentLength);
 
+    esp_http_client_cleanup(client);
     return ESP_OK;
 }
 
-esp_err_t HttpClient::post(std::string url, std::map<std::string, std::string> data) {
+esp_err_t HttpClient::post(const std::string &url,
+                           const std::map<std::string, std::string> &data) {
     esp_http_client_config_t config{
         .url = url.c_str(),
         .method = HTTP_METHOD_POST,
         .event_handler = handleHttpEvent,
     };
-    std::string dataString{};
-    for (const auto &[key, value] : data) {
-        dataString += key + "=" + value + "&";
+#ifdef CONFIG_EXT_CON_STATIC_MEMORY
+    auto &body{requestBody};
+#else
+    std::vector<char> body(encodeForm(data, {}) + 1);
+#endif
+    const auto length{encodeForm(data, body)};
+    if (length >= body.size()) {
+        ESP_LOGE(logTag, "POST data too long: %d bytes", length);
+        Metrics::increment(Counter::AllocationFailures);
+        return ESP_ERR_NO_MEM;
     }
+
     auto client = esp_http_client_init(&config);
-    auto result =
-        esp_http_client_set_post_field(client, dataString.c_str(), dataString.size());
+    if (client == nullptr) {
+        ESP_LOGE(logTag, "Failed to initialize the HTTP client");
+        Metrics::increment(Counter::HttpFailures);
+        return ESP_FAIL;
+    }
+    auto result = esp_http_client_set_post_field(client, body.data(), length);
     if (result != ESP_OK) {
         ESP_LOGE(logTag, "Failed to set POST data: %s", esp_err_to_name(result));
+        esp_http_client_cleanup(client);
         return result;
     }
 
+    Metrics::increment(Counter::HttpRequests);
+    const auto startUs{esp_timer_get_time()};
     result = esp_http_client_perform(client);
+    Metrics::record(Histogram::HttpLatencyMs, (esp_timer_get_time() - startUs) / 1000);
     if (result != ESP_OK) {
+        Metrics::increment(Counter::HttpFailures);
         ESP_LOGE(logTag, "Failed to perform HTTP request: %s", esp_err_to_name(result));
+        esp_http_client_cleanup(client);
         return result;
     }
 
     auto contentLength = esp_http_client_get_content_length(client);
     auto statusCode = esp_http_client_get_status_code(client);
-    ESP_LOGI(logTag, "POST request completed, status code: %d, content length: %lld",
-             statusCode, contentLength);
+    EXT_CON_LOGI(logTag, "POST request completed, status code: %d, content length: %lld",
+                 statusCode, contentLength);
 
+    esp_http_client_cleanup(client);
     return ESP_OK;
 }
 
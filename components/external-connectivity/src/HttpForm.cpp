@@ -0,0 +1,32 @@
+#include "HttpClient.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+namespace extcon::http {
+
+// Kept apart from the client, which needs `esp_http_client`, so that the host build
+// can benchmark it
+size_t HttpClient::encodeForm(const std::map<std::string, std::string> &data,
+                              std::span<char> buffer) {
+    size_t length{0};
+    const auto append{[&](std::string_view part) {
+        if (length + 1 < buffer.size()) {
+            const auto count{std::min(part.size(), buffer.size() - length - 1)};
+            std::copy_n(part.begin(), count, buffer.begin() + length);
+        }
+        length += part.size();
+    }};
+    for (const auto &[key, value] : data) {
+        append(key);
+        append("=");
+        append(value);
+        append("&");
+    }
+    if (!buffer.empty()) {
+        buffer[std::min(length, buffer.size() - 1)] = '\0';
+    }
+    return length;
+}
+
+}  // namespace extcon::http
@@ -0,0 +1,225 @@
+#include "LoadGenerator.hpp"
+
+#include <LoraService.hpp>
+#include <MessageBus.hpp>
+#include <Pipeline.hpp>
+#include <Tasks.hpp>
+#include <Tracing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <functional>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "nimble/nimble_port.h"
+
+namespace {
+
+constexpr auto logTag{"load"};
+
+ble_npl_callout callout;
+bool calloutInitialized{false};
+
+struct Probe {
+    uint32_t sequence;
+};
+
+TaskHandle_t probeTask{};
+extcon::bus::Mailbox<Probe, 16> probeMailbox{
+    "Probe", extcon::metrics::Counter::BusDrops,
+    extcon::metrics::Histogram::BusProbeLatencyUs, 1,
+    [] { xTaskNotifyGive(probeTask); }};
+
+}  // namespace
+
+namespace extcon::bench {
+
+using metrics::Counter;
+using metrics::Gauge;
+using metrics::Histogram;
+using metrics::Metrics;
+
+LoadGenerator::Profile LoadGenerator::profile{};
+int64_t LoadGenerator::startUs{0};
+std::atomic<uint32_t> LoadGenerator::injected{0};
+
+std::vector<Uuid> LoadGenerator::parseMix(std::string_view types) {
+    std::vector<Uuid> mix;
+    while (!types.empty()) {
+        const auto end{std::min(types.find(','), types.size())};
+        const auto name{types.substr(0, end)};
+        types.remove_prefix(std::min(end + 1, types.size()));
+
+        const auto type{
+            std::find_if(uuidToType.begin(), uuidToType.end(),
+                         [&name](const auto &pair) { return pair.second == name; })};
+        if (type == uuidToType.end()) {
+            ESP_LOGW(logTag, "Unknown characteristic type: %.*s", name.size(),
+                     name.data());
+            return {};
+        }
+        mix.push_back(type->first);
+    }
+    return mix;
+}
+
+void LoadGenerator::injectReadings(const Profile &newProfile) {
+    if (injected.load() < profile.count) {
+        ESP_LOGW(logTag, "A load run is already in progress");
+        return;
+    }
+    profile = newProfile;
+    injected.store(0);
+
+    const auto queuedBefore{Metrics::get(Counter::UplinksQueued)};
+    const auto sentBefore{Metrics::get(Counter::UplinksSent)};
+    const auto failedBefore{Metrics::get(Counter::UplinksFailed)};
+    const auto droppedBefore{droppedReadings()};
+    const auto highWaterBefore{Metrics::get(Gauge::UplinkQueueHighWater)};
+    const auto latencyBefore{Metrics::snapshot(Histogram::TransmitLatencyMs)};
+    const auto queueLatencyBefore{Metrics::snapshot(Histogram::LoraQueueLatencyMs)};
+    // The high-water gauge is shared with the health report, so the peak depth of this
+    // run is sampled, unless the gauge rose during the run and holds it exactly
+    uint32_t peakDepth{Metrics::get(Gauge::UplinkQueueDepth)};
+    const auto samplePeak{[&peakDepth] {
+        peakDepth = std::max(peakDepth, Metrics::get(Gauge::UplinkQueueDepth));
+    }};
+
+    ESP_LOGI(logTag, "Injecting %lu readings at %.1f Hz", profile.count, profile.rateHz);
+    if (!calloutInitialized) {
+        ble_npl_callout_init(&callout, nimble_port_get_dflt_eventq(), onTimer, nullptr);
+        calloutInitialized = true;
+    }
+    startUs = esp_timer_get_time();
+    ble_npl_callout_reset(&callout, 0);
+    while (injected.load() < profile.count) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+        samplePeak();
+    }
+    const auto injectedUs{esp_timer_get_time() - startUs};
+
+    const auto drainDeadlineUs{esp_timer_get_time() + profile.drainTimeoutS * 1000000LL};
+    while (Metrics::get(Gauge::UplinkQueueDepth) > 0 &&
+           esp_timer_get_time() < drainDeadlineUs) {
+        vTaskDelay(pdMS_TO_TICKS(500));
+        samplePeak();
+    }
+    const double elapsedS{(esp_timer_get_time() - startUs) / 1e6};
+
+    const auto queued{Metrics::get(Counter::UplinksQueued) - queuedBefore};
+    const auto sent{Metrics::get(Counter::UplinksSent) - sentBefore};
+    const auto failed{Metrics::get(Counter::UplinksFailed) - failedBefore};
+    const auto dropped{droppedReadings() - droppedBefore};
+    if (const auto highWater{Metrics::get(Gauge::UplinkQueueHighWater)};
+        highWater > highWaterBefore) {
+        peakDepth = highWater;
+    }
+    ESP_LOGI(logTag, "%lu readings in %.1f s (%.1f/s offered)", profile.count,
+             injectedUs / 1e6, profile.count / (injectedUs / 1e6));
+    ESP_LOGI(logTag, "%lu uplinks queued, %lu sent, %lu failed in %.1f s (%.2f/s sent)",
+             queued, sent, failed, elapsedS, sent / elapsedS);
+    ESP_LOGI(logTag, "%lu dropped (%.1f%%), queue high-water mark %lu of %d", dropped,
+             queued + dropped > 0 ? 100.0 * dropped / (queued + dropped) : 0.0,
+             peakDepth, lora::uplinkQueueSize);
+    if (const auto pending{Metrics::get(Gauge::UplinkQueueDepth)}; pending > 0) {
+        ESP_LOGW(logTag, "%lu uplinks still queued after %lu s", pending,
+                 profile.drainTimeoutS);
+    }
+    printLatency("LoRa queue", Histogram::LoraQueueLatencyMs, queueLatencyBefore);
+    printLatency("transmit", Histogram::TransmitLatencyMs, latencyBefore);
+#ifdef CONFIG_EXT_CON_TRACING_ENABLE
+    tracing::Tracer::printPercentiles();
+#endif
+}
+
+uint32_t LoadGenerator::droppedReadings() {
+    return Metrics::get(Counter::UplinkQueueDrops) +
+           Metrics::get(Counter::MqttQueueDrops) + Metrics::get(Counter::BusDrops) +
+           Metrics::get(Counter::AllocationFailures);
+}
+
+void LoadGenerator::httpBurst(http::HttpClient &client, const std::string &url,
+                              uint32_t count) {
+    const auto latencyBefore{Metrics::snapshot(Histogram::HttpLatencyMs)};
+    const auto startUs{esp_timer_get_time()};
+    uint32_t failed{0};
+    for (uint32_t i = 0; i < count; i++) {
+        if (client.get(url) != ESP_OK) {
+            failed++;
+        }
+    }
+    const double elapsedS{(esp_timer_get_time() - startUs) / 1e6};
+    ESP_LOGI(logTag, "%lu requests in %.1f s (%.2f/s), %lu failed (%.1f%%)", count,
+             elapsedS, count / elapsedS, failed,
+             count > 0 ? 100.0 * failed / count : 0.0);
+    printLatency("http", Histogram::HttpLatencyMs, latencyBefore);
+}
+
+void LoadGenerator::busProbe(uint32_t count, uint32_t intervalMs) {
+    if (probeTask == nullptr) {
+        // Same priority and core as the LoRa task, so the handoff is the one uplinks see
+        probeTask = tasks::start(
+            {"busProbe", 2048, tasks::loraTask.priority, tasks::transportCore},
+            [](void *) {
+                Probe probe;
+                while (true) {
+                    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                    while (probeMailbox.pop(probe)) {
+                    }
+                }
+            });
+        bus::Topic<Probe>::subscribe(probeMailbox);
+    }
+    const auto latencyBefore{Metrics::snapshot(Histogram::BusProbeLatencyUs)};
+    const auto droppedBefore{Metrics::get(Counter::BusDrops)};
+    for (uint32_t sequence = 0; sequence < count; sequence++) {
+        bus::Topic<Probe>::publish({sequence});
+        vTaskDelay(pdMS_TO_TICKS(intervalMs));
+    }
+    // Let the probe task take the last messages
+    vTaskDelay(pdMS_TO_TICKS(100));
+    ESP_LOGI(logTag, "%lu probes from core %d, %lu dropped", count, xPortGetCoreID(),
+             Metrics::get(Counter::BusDrops) - droppedBefore);
+    printLatency("bus handoff", Histogram::BusProbeLatencyUs, latencyBefore, "us");
+}
+
+void LoadGenerator::onTimer(ble_npl_event *) {
+    // Readings are due at fixed offsets from the start; a late timer catches up with
+    // a burst, as the NimBLE tick is coarser than the rates of interest
+    const auto nowUs{esp_timer_get_time()};
+    const auto due{std::min<uint32_t>(
+        profile.count,
+        static_cast<uint32_t>((nowUs - startUs) * profile.rateHz / 1e6) + 1)};
+    for (auto sequence{injected.load()}; sequence < due; sequence++) {
+        tracing::Trace trace{};
+        trace.stamp(tracing::Stage::Receive);
+        const auto uuid{profile.mix[sequence % profile.mix.size()]};
+        const auto value{10 + 5 * std::sin(sequence * 0.1)};
+        char buffer[64];
+        const auto width{std::min(profile.valueSize, sizeof(buffer) - 1)};
+        const auto result{std::format_to_n(buffer, sizeof(buffer) - 1, "{:0{}.2f}",
+                                           value, width)};
+        telemetry::Pipeline::forwardValue(
+            uuid, {buffer, static_cast<size_t>(result.out - buffer)}, trace);
+        injected.store(sequence + 1);
+    }
+    if (due >= profile.count) {
+        return;
+    }
+    const auto nextUs{startUs + static_cast<int64_t>(due * 1e6 / profile.rateHz)};
+    const auto delayMs{
+        static_cast<uint32_t>(std::max<int64_t>((nextUs - nowUs) / 1000, 1))};
+    ble_npl_callout_reset(&callout, ble_npl_time_ms_to_ticks32(delayMs));
+}
+
+void LoadGenerator::printLatency(const char *name, Histogram histogram,
+                                 const Metrics::Buckets &before, const char *unit) {
+    auto buckets{Metrics::snapshot(histogram)};
+    std::transform(buckets.begin(), buckets.end(), before.begin(), buckets.begin(),
+                   std::minus{});
+    Metrics::printPercentiles(name, buckets, unit);
+}
+
+}  // namespace extcon::bench
@@ -0,0 +1,139 @@
+#include "LoraMac.hpp"
+
+#include <esp_log.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+
+namespace extcon::lora {
+
+constexpr auto logTag = "lora";
+
+uint32_t LoraMac::airtimeMs(uint8_t dataRate, size_t payloadLength) {
+    // Semtech AN1200.13 with 125 kHz bandwidth, coding rate 4/5, explicit header,
+    // CRC on and 8 preamble symbols; LoRaWAN adds 13 bytes of framing
+    constexpr double bandwidthKhz{125};
+    constexpr size_t framingLength{13};
+    const uint8_t spreadingFactor{lora::spreadingFactor(dataRate)};
+    const int lowDataRateOptimize{spreadingFactor >= 11 ? 1 : 0};
+    const double symbolMs{std::pow(2.0, spreadingFactor) / bandwidthKhz};
+    const double preambleMs{(8 + 4.25) * symbolMs};
+    const double payloadBits{8.0 * (payloadLength + framingLength) -
+                             4.0 * spreadingFactor + 28 + 16};
+    const double payloadSymbols{
+        8 + std::max(std::ceil(payloadBits /
+                               (4.0 * (spreadingFactor - 2 * lowDataRateOptimize))) *
+                         5,
+                     0.0)};
+    return static_cast<uint32_t>(std::ceil(preambleMs + payloadSymbols * symbolMs));
+}
+
+uint32_t LoraMac::keyFingerprint(const std::string &devEui, const std::string &appEui,
+                                 const std::string &appKey) {
+    uint32_t hash{2166136261};
+    for (const auto *key : {&devEui, &appEui, &appKey}) {
+        for (const auto character : *key) {
+            hash = (hash ^ static_cast<uint8_t>(character)) * 16777619;
+        }
+    }
+    return hash;
+}
+
+SimulatedLoraMac::SimulatedLoraMac(uint8_t spreadingFactor, uint8_t lossPercent)
+    : currentDataRate{static_cast<uint8_t>(12 - spreadingFactor)},
+      lastRadioDataRate{currentDataRate},
+      lossPercent{lossPercent} {
+}
+
+bool SimulatedLoraMac::init(const std::string &, const std::string &,
+                            const std::string &) {
+    ESP_LOGW(logTag, "Using simulated LoRa MAC, DR%d, loss: %d%%", currentDataRate,
+             lossPercent);
+    return true;
+}
+
+bool SimulatedLoraMac::join() {
+    // Join request is 23 bytes on air, 10 bytes more than the regular framing
+    transmit(10);
+    // Join accept is received in the RX1 window 5 s after the request
+    vTaskDelay(pdMS_TO_TICKS(5000));
+    return true;
+}
+
+TTNResponseCode SimulatedLoraMac::transmitMessage(const uint8_t *, size_t length,
+                                                  port_t, bool confirm) {
+    if (!confirm) {
+        transmit(length);
+        // RX1 and RX2 windows open 1 s and 2 s after the end of the transmission
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        lastRadioDataRate = rx2DataRate;
+        // Unconfirmed uplinks succeed once sent, lost or not
+        return kTTNSuccessfulTransmission;
+    }
+    for (uint8_t attempt = 0; attempt < confirmedAttempts; attempt++) {
+        if (attempt > 0 && attempt % 2 == 0 && currentDataRate > 0) {
+            currentDataRate--;
+        }
+        transmit(length);
+        vTaskDelay(pdMS_TO_TICKS(2000));
+        lastRadioDataRate = rx2DataRate;
+        // Both the uplink and the acknowledgement in the downlink have to get through
+        if (!lost() && !lost()) {
+            return kTTNSuccessfulTransmission;
+        }
+    }
+    return kTTNErrorTransmissionFailed;
+}
+
+void SimulatedLoraMac::onMessage(TTNMessageCallback) {
+    // The simulated network never sends downlinks
+}
+
+void SimulatedLoraMac::setAdrEnabled(bool) {
+}
+
+void SimulatedLoraMac::setDataRate(uint8_t dataRate) {
+    currentDataRate = std::min(dataRate, maxDataRate);
+}
+
+void SimulatedLoraMac::setMaxTxPower(int8_t) {
+}
+
+uint8_t SimulatedLoraMac::dataRate() {
+    return currentDataRate;
+}
+
+uint8_t SimulatedLoraMac::radioDataRate() const {
+    return lastRadioDataRate;
+}
+
+bool SimulatedLoraMac::resumeSession() {
+    return false;
+}
+
+bool SimulatedLoraMac::saveSession(bool) {
+    return true;
+}
+
+bool SimulatedLoraMac::lost() const {
+    return esp_random() % 100 < lossPercent;
+}
+
+void SimulatedLoraMac::transmit(size_t payloadLength) {
+    const auto nowMs{esp_timer_get_time() / 1000};
+    if (nextTransmitMs > nowMs) {
+        vTaskDelay(pdMS_TO_TICKS(nextTransmitMs - nowMs));
+    }
+    const auto airtime{airtimeMs(currentDataRate, payloadLength)};
+    lastRadioDataRate = currentDataRate;
+    vTaskDelay(pdMS_TO_TICKS(airtime));
+    // 1% duty cycle: the sub-band is unavailable for 99 times the airtime
+    nextTransmitMs = esp_timer_get_time() / 1000 + 99 * airtime;
+}
+
+}  // namespace extcon::lora
@@ -1,83 +1,205 @@
 #include "LoraService.hpp"
 
-#include <driver/gpio.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 
-#include <BleService.hpp>
+#include <DeferredLog.hpp>
+#include <Metrics.hpp>
+#include <Tasks.hpp>
+
+#include <algorithm>
+#include <cstdlib>
 
 #include "InternalMappings.hpp"
 
+#ifndef CONFIG_EXT_CON_LORA_SIMULATED
+#include <TtnLoraMac.hpp>
+#endif
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+#include <OtaUpdater.hpp>
+#endif
+
 namespace extcon::lora {
 
+using metrics::Counter;
+using metrics::Gauge;
+using metrics::Histogram;
+using metrics::Metrics;
+using tracing::Stage;
+using tracing::Tracer;
+
 constexpr auto logTag = "lora";
 
-bool LoraService::networkJoined = false;
-std::queue<std::string> LoraService::uplinkQueue;
+#if defined(CONFIG_EXT_CON_LORA_DR_POLICY_FIXED)
+constexpr DataRatePolicy dataRatePolicy{DataRatePolicy::Fixed};
+#elif defined(CONFIG_EXT_CON_LORA_DR_POLICY_THROUGHPUT)
+constexpr DataRatePolicy dataRatePolicy{DataRatePolicy::Throughput};
+#else
+constexpr DataRatePolicy dataRatePolicy{DataRatePolicy::NetworkAdr};
+#endif
+// Binary health report, see `Metrics::healthReport`
+constexpr port_t healthPort{2};
+constexpr uint8_t rejoinThreshold{CONFIG_EXT_CON_LORA_REJOIN_THRESHOLD};
+// Acknowledged uplinks in a row before the throughput policy tries a faster data rate
+constexpr uint8_t probeThreshold{8};
+#ifdef CONFIG_EXT_CON_LORA_SESSION_PERSISTENCE
+constexpr uint32_t sessionSaveInterval{CONFIG_EXT_CON_LORA_SESSION_SAVE_INTERVAL};
+#endif
+
+std::atomic<bool> LoraService::networkJoined{false};
+bus::Mailbox<bus::Uplink, uplinkQueueSize> LoraService::uplinkMailbox{
+    "LoRa", Counter::UplinkQueueDrops, Histogram::LoraQueueLatencyMs, 1000,
+    onUplinkQueued};
+std::atomic<TaskHandle_t> LoraService::loopTask{};
 
 void LoraService::loop(void* pvParameter) {
     LoraService* loraServiceHandle = static_cast<LoraService*>(pvParameter);
     assert(loraServiceHandle != nullptr);
+    loopTask = xTaskGetCurrentTaskHandle();
 
     loraServiceHandle->joinNetwork();
 
+#if CONFIG_EXT_CON_HEALTH_UPLINK_INTERVAL > 0
+    constexpr int64_t healthIntervalUs{CONFIG_EXT_CON_HEALTH_UPLINK_INTERVAL *
+                                       1000000LL};
+    int64_t nextHealthUs{esp_timer_get_time() + healthIntervalUs};
+#endif
+
     while (true) {
-        if (!uplinkQueue.empty()) {
-            std::string message{uplinkQueue.front()};
-            ESP_LOGI(logTag, "Sending uplink message: \"%s\"", message.c_str());
+#if CONFIG_EXT_CON_HEALTH_UPLINK_INTERVAL > 0
+        if (esp_timer_get_time() >= nextHealthUs) {
+            loraServiceHandle->sendHealthReport();
+            nextHealthUs += healthIntervalUs;
+        }
+#endif
 
-            TTNResponseCode result{loraServiceHandle->ttn.transmitMessage(
-                reinterpret_cast<const uint8_t*>(message.c_str()), message.length())};
-            ESP_LOGI(logTag, "%s",
-                     result == kTTNSuccessfulTransmission ? "Message sent"
-                                                          : "Transmission failed");
-            uplinkQueue.pop();
+        bus::Uplink uplink;
+        if (!uplinkMailbox.pop(uplink)) {
+            Metrics::set(Gauge::LoraStackHighWater,
+                         uxTaskGetStackHighWaterMark(nullptr));
+            // Woken by the next uplink, the timeout keeps the health report on time
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+            continue;
         }
+        auto &[message, port, trace]{uplink};
+        trace.stamp(Stage::Dequeue);
+        EXT_CON_LOGI(logTag, "Sending uplink message: \"%s\"", message.c_str());
 
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        const auto startUs{esp_timer_get_time()};
+        trace.stamp(Stage::TransmitStart);
+        const TTNResponseCode result{
+            loraServiceHandle->transmit({message.c_str(), message.length()}, port)};
+        trace.stamp(Stage::TransmitDone);
+        Tracer::record(trace);
+        Metrics::record(Histogram::TransmitLatencyMs,
+                        (esp_timer_get_time() - startUs) / 1000);
+        Metrics::increment(result == kTTNSuccessfulTransmission
+                               ? Counter::UplinksSent
+                               : Counter::UplinksFailed);
+        if (result == kTTNSuccessfulTransmission &&
+            Metrics::get(Gauge::BootToFirstUplinkMs) == 0) {
+            const auto bootToUplinkMs{esp_timer_get_time() / 1000};
+            Metrics::set(Gauge::BootToFirstUplinkMs, bootToUplinkMs);
+            ESP_LOGI(logTag, "First uplink sent %lld ms after boot", bootToUplinkMs);
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+            // The network took it, so an updated image can reach it
+            ota::OtaUpdater::confirmImage();
+#endif
+        }
+        EXT_CON_LOGI(logTag, "%s",
+                     result == kTTNSuccessfulTransmission ? "Message sent"
+                                                          : "Transmission failed");
+        Metrics::set(Gauge::UplinkQueueDepth, uplinkMailbox.size());
     }
 }
 
+void LoraService::sendHealthReport() {
+    // Sized to the current data rate, so the report is never dropped for its length
+    std::array<uint8_t, bus::maxPayloadSize> report;
+    const auto length{Metrics::healthReport(report.data(), maxPayload())};
+    EXT_CON_LOGI(logTag, "Sending health report of %d bytes", length);
+    const auto result{
+        transmit({reinterpret_cast<const char*>(report.data()), length}, healthPort)};
+    Metrics::increment(result == kTTNSuccessfulTransmission ? Counter::UplinksSent
+                                                            : Counter::UplinksFailed);
+}
+
 void LoraService::onDownlinkMessage(const uint8_t* message, size_t length, port_t port) {
     if (length == 0) {
         ESP_LOGI(logTag, "Empty message received");
         return;
     }
-    std::string messageString{reinterpret_cast<const char*>(message), length};
-    ESP_LOGI(logTag, "Message received: \"%s\", length: %d, port: %d",
-             messageString.c_str(), length, port);
+    const std::string_view value{reinterpret_cast<const char*>(message), length};
+    ESP_LOGI(logTag, "Message received: \"%.*s\", length: %d, port: %d", length,
+             value.data(), length, port);
+    if (!portToUuid.contains(port)) {
+        ESP_LOGW(logTag, "Ignoring message on port %d", port);
+        return;
+    }
+    if (length > bus::maxPayloadSize) {
+        ESP_LOGW(logTag, "Message too long: %d bytes", length);
+        Metrics::increment(Counter::AllocationFailures);
+        return;
+    }
 
-    const auto uuid{portToUuid.at(port)};
-    ble::BleService::writeValue(uuid, messageString);
+    bus::Topic<bus::PeripheralWrite>::publish(
+        {portToUuid.at(port), bus::Payload{value}});
 }
 
-void LoraService::sendUplinkMessage(const std::string& message) {
-    if (!networkJoined) {
-        ESP_LOGW(logTag, "Network not joined yet, the message will be sent later");
+void LoraService::onUplinkQueued() {
+    const auto depth{uplinkMailbox.size()};
+    Metrics::increment(Counter::UplinksQueued);
+    Metrics::set(Gauge::UplinkQueueDepth, depth);
+    Metrics::setMax(Gauge::UplinkQueueHighWater, depth);
+    // Publishers may run before the loop task set its handle
+    if (const auto task{loopTask.load()}; task != nullptr) {
+        xTaskNotifyGive(task);
     }
-    constexpr size_t maxQueueSize{100};
-    if (uplinkQueue.size() >= maxQueueSize) {
-        ESP_LOGW(logTag, "Uplink queue is full, the message will be dropped");
-        return;
-    }
-    uplinkQueue.push(message);
 }
 
 LoraService::LoraService(std::string appEui, std::string appKey, std::string devEui)
-    : appEui{appEui}, appKey{appKey}, devEui{devEui} {
+    : appEui{appEui},
+      appKey{appKey},
+      devEui{devEui},
+#ifdef CONFIG_EXT_CON_LORA_DR_POLICY_FIXED
+      preferredDataRate{CONFIG_EXT_CON_LORA_FIXED_DATA_RATE} {
+#else
+      preferredDataRate{maxDataRate} {
+#endif
+#ifdef CONFIG_EXT_CON_LORA_SIMULATED
+    mac = std::make_unique<SimulatedLoraMac>(CONFIG_EXT_CON_LORA_SIM_SPREADING_FACTOR,
+                                             CONFIG_EXT_CON_LORA_SIM_LOSS_PERCENT);
+#else
+    mac = std::make_unique<TtnLoraMac>();
+#endif
+
+    const char* ports{CONFIG_EXT_CON_LORA_CONFIRMED_PORTS};
+    while (*ports != '\0') {
+        char* end{};
+        const long port{std::strtol(ports, &end, 10)};
+        if (end == ports) {
+            ports++;
+            continue;
+        }
+        if (port >= 1 && port <= 223) {
+            confirmedPorts.set(port);
+        } else {
+            ESP_LOGW(logTag, "Ignoring invalid confirmed uplink port %ld", port);
+        }
+        ports = end;
+    }
+    bus::Topic<bus::Uplink>::subscribe(uplinkMailbox);
 }
 
 bool LoraService::init() {
-    spi_bus_config_t busConfig{};
-    busConfig.mosi_io_num = GPIO_NUM_27;
-    busConfig.miso_io_num = GPIO_NUM_19;
-    busConfig.sclk_io_num = GPIO_NUM_5;
-    ESP_ERROR_CHECK(spi_bus_initialize(HSPI_HOST, &busConfig, SPI_DMA_DISABLED));
-
-    ttn.configurePins(HSPI_HOST, GPIO_NUM_18, TTN_NOT_CONNECTED, GPIO_NUM_23,
-                      GPIO_NUM_26, GPIO_NUM_33);
-    ttn.provision(devEui.c_str(), appEui.c_str(), appKey.c_str());
-    ttn.onMessage(onDownlinkMessage);
+    if (!mac->init(devEui, appEui, appKey)) {
+        ESP_LOGE(logTag, "LoRa MAC failed to initialize");
+        return false;
+    }
+    mac->onMessage(onDownlinkMessage);
+    mac->setAdrEnabled(dataRatePolicy == DataRatePolicy::NetworkAdr);
+    mac->setMaxTxPower(CONFIG_EXT_CON_LORA_MAX_TX_POWER);
 
     ESP_LOGI(logTag, "LoRa service initialized");
     return true;
@@ -89,20 +211,165 @@ void LoraService::start(bool asTask) {
         loop(this);
         return;
     }
-    constexpr uint32_t stackDepth{4096};
-    xTaskCreate(loop, "loraLoop", stackDepth, static_cast<void*>(this), 1, nullptr);
+    tasks::start(tasks::loraTask, loop, static_cast<void*>(this));
 }
 
 void LoraService::joinNetwork() {
+#ifdef CONFIG_EXT_CON_LORA_SESSION_PERSISTENCE
+    if (mac->resumeSession()) {
+        // The MAC only knows the uplink data rate once set, with ADR the initial one
+        mac->setDataRate(preferredDataRate);
+        networkJoined = true;
+        ESP_LOGI(logTag, "Session resumed, skipping join");
+        return;
+    }
+#endif
+    join();
+}
+
+void LoraService::join() {
+    networkJoined = false;
     ESP_LOGI(logTag, "Joining network");
-    bool success = ttn.join();
+    Metrics::increment(Counter::JoinAttempts);
+    bool success = mac->join() && saveSession(true);
     while (!success) {
         ESP_LOGE(logTag, "Join failed, retrying in 30 seconds");
         vTaskDelay(30 * pdMS_TO_TICKS(1000));
-        success = ttn.join();
+        Metrics::increment(Counter::JoinAttempts);
+        success = mac->join() && saveSession(true);
     }
+    mac->setDataRate(preferredDataRate);
     networkJoined = true;
     ESP_LOGI(logTag, "Network joined successfully");
 }
 
+bool LoraService::saveSession(bool joined) {
+#ifdef CONFIG_EXT_CON_LORA_SESSION_PERSISTENCE
+    // Flash is only written after joining and every few uplinks for wear
+    const bool durable{joined || ++transmissionsSinceSave >= sessionSaveInterval};
+    if (durable) {
+        transmissionsSinceSave = 0;
+    }
+    if (!mac->saveSession(durable)) {
+        ESP_LOGE(logTag, "LoRa MAC failed to restart after saving the session");
+        return false;
+    }
+#endif
+    return true;
+}
+
+uint8_t LoraService::dataRate() const {
+    return dataRatePolicy == DataRatePolicy::NetworkAdr
+               ? std::min(mac->dataRate(), maxDataRate)
+               : preferredDataRate;
+}
+
+size_t LoraService::maxPayload() const {
+    return std::min(maxPayloadSizes[dataRate()], bus::maxPayloadSize);
+}
+
+void LoraService::printStatistics() const {
+    constexpr std::array policyNames{"adr", "fixed", "throughput"};
+    ESP_LOGI(logTag, "%s, policy: %s, data rate: DR%d, max payload: %d",
+             networkJoined ? "joined" : "not joined",
+             policyNames[static_cast<size_t>(dataRatePolicy)], dataRate(), maxPayload());
+    for (uint8_t dataRate = 0; dataRate <= maxDataRate; dataRate++) {
+        const auto& [transmissions, failures, airtimeMs]{dataRateStatistics[dataRate]};
+        if (transmissions == 0) {
+            continue;
+        }
+        ESP_LOGI(logTag,
+                 "DR%d (SF%d): %lu sent, %lu failed, %lu%% success, %lu ms airtime",
+                 dataRate, spreadingFactor(dataRate), transmissions, failures,
+                 100 * (transmissions - failures) / transmissions, airtimeMs);
+    }
+}
+
+std::optional<uint8_t> LoraService::selectDataRate(size_t payloadLength) const {
+    const uint8_t current{dataRate()};
+    if (payloadLength <= maxPayloadSizes[current]) {
+        return current;
+    }
+    if (dataRatePolicy != DataRatePolicy::Throughput) {
+        return std::nullopt;
+    }
+    // The slowest faster data rate the payload fits in, only for this uplink
+    for (uint8_t faster = current + 1; faster <= maxDataRate; faster++) {
+        if (payloadLength <= maxPayloadSizes[faster]) {
+            return faster;
+        }
+    }
+    return std::nullopt;
+}
+
+TTNResponseCode LoraService::transmit(std::string_view message, port_t port) {
+    const auto selected{selectDataRate(message.size())};
+    if (!selected) {
+        ESP_LOGW(logTag, "Uplink message of %d bytes exceeds %d bytes at DR%d, dropped",
+                 message.size(), maxPayloadSizes[dataRate()], dataRate());
+        return kTTNErrorTransmissionFailed;
+    }
+    // Set for every uplink, as LMIC lowers the data rate of confirmed retransmissions
+    if (dataRatePolicy != DataRatePolicy::NetworkAdr) {
+        mac->setDataRate(*selected);
+    }
+
+    // A confirmed uplink only succeeds once the network acknowledged it. LMIC retries
+    // it on its own, up to `confirmedAttempts` transmissions at falling data rates, so
+    // the statistics charge one transmission at the data rate it started at.
+    const bool confirm{confirmedPorts.test(port)};
+    const uint8_t used{*selected};
+    const TTNResponseCode result{
+        mac->transmitMessage(reinterpret_cast<const uint8_t*>(message.data()),
+                             message.size(), port, confirm)};
+    auto& statistics{dataRateStatistics[used]};
+    statistics.transmissions++;
+    statistics.airtimeMs += LoraMac::airtimeMs(used, message.size());
+    if (result != kTTNSuccessfulTransmission) {
+        statistics.failures++;
+    }
+    if (confirm) {
+        adaptDataRate(*selected, result == kTTNSuccessfulTransmission);
+    }
+    // The frame counter advanced. A MAC that failed to restart after saving the session
+    // stays silent until it joins again.
+    if (!saveSession(false)) {
+        join();
+        return result;
+    }
+    // The network may have lost the session, e.g. a resumed one whose frame counter
+    // lags behind, which only a new join recovers from
+    if (confirm && rejoinThreshold > 0) {
+        unacknowledgedInRow =
+            result == kTTNSuccessfulTransmission ? 0 : unacknowledgedInRow + 1;
+        if (unacknowledgedInRow >= rejoinThreshold) {
+            ESP_LOGW(logTag, "%d confirmed uplinks not acknowledged, joining again",
+                     unacknowledgedInRow);
+            unacknowledgedInRow = 0;
+            join();
+        }
+    }
+    return result;
+}
+
+void LoraService::adaptDataRate(uint8_t dataRate, bool acknowledged) {
+    // Only uplinks at the preferred data rate tell anything about the link
+    if (dataRatePolicy != DataRatePolicy::Throughput || dataRate != preferredDataRate) {
+        return;
+    }
+    if (!acknowledged) {
+        acknowledgedInRow = 0;
+        if (preferredDataRate > 0) {
+            preferredDataRate--;
+            ESP_LOGI(logTag, "Falling back to DR%d", preferredDataRate);
+        }
+        return;
+    }
+    if (++acknowledgedInRow >= probeThreshold && preferredDataRate < maxDataRate) {
+        acknowledgedInRow = 0;
+        preferredDataRate++;
+        ESP_LOGI(logTag, "Trying DR%d", preferredDataRate);
+    }
+}
+
 }  // namespace extcon::lora
\ No newline at end of file
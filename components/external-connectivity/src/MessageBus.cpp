@@ -0,0 +1,25 @@
+#include "MessageBus.hpp"
+
+#include <esp_log.h>
+
+namespace extcon::bus {
+
+using metrics::Counter;
+using metrics::Histogram;
+using metrics::Metrics;
+
+constexpr auto logTag = "bus";
+
+void printStatistics() {
+    ESP_LOGI(logTag, "Uplinks dropped by LoRa: %lu, by MQTT: %lu, other messages: %lu",
+             Metrics::get(Counter::UplinkQueueDrops),
+             Metrics::get(Counter::MqttQueueDrops), Metrics::get(Counter::BusDrops));
+    Metrics::printPercentiles("LoRa queue",
+                              Metrics::snapshot(Histogram::LoraQueueLatencyMs));
+    Metrics::printPercentiles("MQTT queue",
+                              Metrics::snapshot(Histogram::MqttQueueLatencyMs));
+    Metrics::printPercentiles("BLE write",
+                              Metrics::snapshot(Histogram::BleWriteLatencyUs), "us");
+}
+
+}  // namespace extcon::bus
@@ -0,0 +1,159 @@
+#include "Metrics.hpp"
+
+#include <esp_log.h>
+#include <esp_system.h>
+#include <sdkconfig.h>
+
+#include <format>
+#include <limits>
+#include <numeric>
+#include <string>
+
+namespace extcon::metrics {
+
+constexpr auto logTag = "metrics";
+
+constexpr std::array<const char *, static_cast<size_t>(Counter::Count)> counterNames{
+    "notifications_received",
+    "values_polled",
+    "uplinks_queued",
+    "uplinks_sent",
+    "uplinks_failed",
+    "uplink_queue_drops",
+    "join_attempts",
+    "ble_connects",
+    "ble_disconnects",
+    "http_requests",
+    "http_failures",
+    "log_drops",
+    "allocation_failures",
+    "mqtt_readings",
+    "mqtt_publishes",
+    "mqtt_publish_failures",
+    "mqtt_offline_drops",
+    "mqtt_bytes",
+    "bus_drops",
+    "mqtt_queue_drops",
+};
+
+constexpr std::array<const char *, static_cast<size_t>(Gauge::Count)> gaugeNames{
+    "uplink_queue_depth",
+    "uplink_queue_high_water",
+    "free_heap",
+    "min_free_heap",
+    "lora_stack_high_water",
+    "boot_to_first_uplink_ms",
+};
+
+constexpr std::array<const char *, static_cast<size_t>(Histogram::Count)>
+    histogramNames{
+        "transmit_latency_ms",
+        "http_latency_ms",
+        "mqtt_publish_latency_ms",
+        "lora_queue_latency_ms",
+        "mqtt_queue_latency_ms",
+        "ble_write_latency_us",
+        "bus_probe_latency_us",
+    };
+
+decltype(Metrics::counters) Metrics::counters{};
+decltype(Metrics::gauges) Metrics::gauges{};
+decltype(Metrics::histograms) Metrics::histograms{};
+
+void Metrics::print() {
+    updateHeapGauges();
+    for (size_t i = 0; i < counters.size(); i++) {
+        ESP_LOGI(logTag, "%-24s %lu", counterNames[i], counters[i].load());
+    }
+    for (size_t i = 0; i < gauges.size(); i++) {
+        ESP_LOGI(logTag, "%-24s %lu", gaugeNames[i], gauges[i].load());
+    }
+    for (size_t i = 0; i < histograms.size(); i++) {
+        std::string buckets{};
+        for (size_t bucket = 0; bucket < histograms[i].size(); bucket++) {
+            if (bucket < bucketBounds.size()) {
+                buckets += std::format("<{}:{} ", bucketBounds[bucket],
+                                       histograms[i][bucket].load());
+            } else {
+                buckets += std::format(">={}:{}", bucketBounds.back(),
+                                       histograms[i][bucket].load());
+            }
+        }
+        ESP_LOGI(logTag, "%-24s %s", histogramNames[i], buckets.c_str());
+    }
+}
+
+uint32_t Metrics::percentile(const Buckets &buckets, uint32_t percent) {
+    const auto count{std::accumulate(buckets.begin(), buckets.end(), uint32_t{0})};
+    const uint32_t rank{(count * percent + 99) / 100};
+    uint32_t seen{0};
+    for (size_t bucket = 0; bucket < bucketBounds.size(); bucket++) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return bucketBounds[bucket];
+        }
+    }
+    return std::numeric_limits<uint32_t>::max();
+}
+
+void Metrics::printPercentiles(const char *name, const Buckets &buckets,
+                               const char *unit) {
+    const auto count{std::accumulate(buckets.begin(), buckets.end(), uint32_t{0})};
+    if (count == 0) {
+        ESP_LOGI(logTag, "No %s latency samples", name);
+        return;
+    }
+    const auto bound{[&buckets](uint32_t percent) {
+        const auto value{percentile(buckets, percent)};
+        return value == std::numeric_limits<uint32_t>::max()
+                   ? std::format(">{}", bucketBounds.back())
+                   : std::format("<{}", value);
+    }};
+    ESP_LOGI(logTag, "%s latency over %lu samples in %s: p50 %s, p90 %s, p99 %s", name,
+             count, unit, bound(50).c_str(), bound(90).c_str(), bound(99).c_str());
+}
+
+size_t Metrics::healthReport(uint8_t *buffer, size_t size) {
+    updateHeapGauges();
+    // Most telling first, as slow data rates only carry the first dozen. MQTT queue
+    // drops stay in the bus drops field, so the layout is unchanged.
+    const std::array<uint32_t, 16> fields{
+        get(Counter::UplinksSent),
+        get(Counter::UplinksFailed),
+        get(Counter::UplinkQueueDrops),
+        get(Counter::JoinAttempts),
+        get(Counter::BleDisconnects),
+        get(Counter::AllocationFailures),
+        get(Counter::BusDrops) + get(Counter::MqttQueueDrops),
+        get(Counter::LogDrops),
+        get(Gauge::MinFreeHeap),
+        get(Gauge::UplinkQueueHighWater),
+        get(Gauge::LoraStackHighWater),
+        get(Gauge::BootToFirstUplinkMs),
+        get(Counter::HttpFailures),
+        get(Counter::MqttPublishFailures),
+        get(Counter::MqttOfflineDrops),
+        get(Counter::NotificationsReceived),
+    };
+    if (size == 0) {
+        return 0;
+    }
+    buffer[0] = healthReportVersion;
+    size_t length{1};
+    for (const auto field : fields) {
+        if (length + sizeof(field) > size) {
+            break;
+        }
+        for (size_t byte = 0; byte < sizeof(field); byte++) {
+            buffer[length++] = static_cast<uint8_t>(field >> (8 * byte));
+        }
+    }
+    return length;
+}
+
+void Metrics::updateHeapGauges() {
+    set(Gauge::FreeHeap, esp_get_free_heap_size());
+    set(Gauge::MinFreeHeap, esp_get_minimum_free_heap_size());
+}
+
+}  // namespace extcon::metrics
@@ -1,23 +1,29 @@
 #include "ModemConsole.hpp"
 
+#include <Benchmark.hpp>
+#include <LoadGenerator.hpp>
+#include <MessageBus.hpp>
+#include <Metrics.hpp>
+#include <MqttClient.hpp>
+#include <OtaUpdater.hpp>
+#include <Tracing.hpp>
+#include <cstdlib>
 #include <map>
 #include <numeric>
 
 namespace extcon::repl {
 
-using esp_modem::modem_mode;
-
 constexpr auto logTag = "repl";
 
 ModemConsole *CommandRegistry::console{};
-GsmService *CommandRegistry::gsmService{};
+Modem *CommandRegistry::modem{};
 HttpClient *CommandRegistry::httpClient{};
 LoraService *CommandRegistry::loraService{};
 
-ModemConsole::ModemConsole(GsmService *gsmService, HttpClient *httpClient,
+ModemConsole::ModemConsole(Modem *modem, HttpClient *httpClient,
                            LoraService *loraService)
     : commandRegistry{
-          std::make_unique<CommandRegistry>(this, gsmService, httpClient, loraService)} {
+          std::make_unique<CommandRegistry>(this, modem, httpClient, loraService)} {
     replConfig = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
     uartConfig = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_console_new_repl_uart(&uartConfig, &replConfig, &repl));
@@ -33,10 +39,10 @@ void ModemConsole::waitForExit() {
     repl->del(repl);
 }
 
-CommandRegistry::CommandRegistry(ModemConsole *console, GsmService *gsmService,
+CommandRegistry::CommandRegistry(ModemConsole *console, Modem *modem,
                                  HttpClient *httpClient, LoraService *loraService) {
     CommandRegistry::console = console;
-    CommandRegistry::gsmService = gsmService;
+    CommandRegistry::modem = modem;
     CommandRegistry::httpClient = httpClient;
     CommandRegistry::loraService = loraService;
 }
@@ -49,20 +55,104 @@ void CommandRegistry::registerCommands() {
              return ESP_OK;
          },
          nullptr},
+        {"stats", "Prints runtime metrics", nullptr,
+         [](int, char **) {
+             metrics::Metrics::print();
+             return ESP_OK;
+         },
+         nullptr},
+        {"trace", "Prints uplink latency percentiles or raw traces", "[dump]",
+         [](int argc, char **argv) {
+             if (argc == 2 && std::string{argv[1]} == "dump") {
+                 tracing::Tracer::dump();
+             } else if (argc == 1) {
+                 tracing::Tracer::printPercentiles();
+             } else {
+                 return ESP_ERR_INVALID_ARG;
+             }
+             return ESP_OK;
+         },
+         nullptr},
+        {"bus", "Prints message bus queue latencies and drops", nullptr,
+         [](int, char **) {
+             bus::printStatistics();
+             return ESP_OK;
+         },
+         nullptr},
     };
 
-    if (gsmService && httpClient) {
+#ifdef CONFIG_EXT_CON_BENCHMARK_ENABLE
+    commands.push_back({"bench", "Runs the hot path microbenchmarks", nullptr,
+                        [](int, char **) {
+                            bench::Benchmark::runAll();
+                            return ESP_OK;
+                        },
+                        nullptr});
+    commands.push_back(
+        {"load", "Injects synthetic readings and prints a throughput summary",
+         "<count> <rate Hz> [value size] [types] [drain timeout s]",
+         [](int argc, char **argv) {
+             if (argc < 3 || argc > 6) {
+                 return ESP_ERR_INVALID_ARG;
+             }
+             bench::LoadGenerator::Profile profile{
+                 .count = static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)),
+                 .rateHz = std::strtof(argv[2], nullptr),
+                 .valueSize = static_cast<size_t>(
+                     argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 0),
+                 .mix = bench::LoadGenerator::parseMix(
+                     argc > 4 ? argv[4] : "current_measurement"),
+                 .drainTimeoutS = static_cast<uint32_t>(
+                     argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 120),
+             };
+             if (profile.count == 0 || profile.rateHz <= 0 || profile.mix.empty()) {
+                 return ESP_ERR_INVALID_ARG;
+             }
+             bench::LoadGenerator::injectReadings(profile);
+             return ESP_OK;
+         },
+         nullptr});
+    commands.push_back(
+        {"busprobe", "Measures the cross-task handoff latency over the message bus",
+         "<count> [interval ms]",
+         [](int argc, char **argv) {
+             if (argc < 2 || argc > 3) {
+                 return ESP_ERR_INVALID_ARG;
+             }
+             bench::LoadGenerator::busProbe(
+                 std::strtoul(argv[1], nullptr, 10),
+                 argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10);
+             return ESP_OK;
+         },
+         nullptr});
+    if (httpClient) {
+        commands.push_back({"httpload", "Performs back-to-back GET requests",
+                            "<url> <count>",
+                            [](int argc, char **argv) {
+                                if (argc != 3) {
+                                    return ESP_ERR_INVALID_ARG;
+                                }
+                                bench::LoadGenerator::httpBurst(
+                                    *httpClient, argv[1],
+                                    std::strtoul(argv[2], nullptr, 10));
+                                return ESP_OK;
+                            },
+                            nullptr});
+    }
+#endif
+
+    if (modem && httpClient) {
         std::vector<esp_console_cmd_t> gsmCommands{
             {"mode", "Sets the modem mode", "<PPP|CMD>",
              [](int argc, char **argv) {
-                 std::map<std::string, modem_mode> mode{
-                     {"PPP", modem_mode::DATA_MODE},
-                     {"CMD", modem_mode::COMMAND_MODE},
+                 std::map<std::string, gsm::ModemMode> mode{
+                     {"PPP", gsm::ModemMode::Data},
+                     {"CMD", gsm::ModemMode::Command},
                  };
                  if (argc != 2 || !mode.contains(argv[1])) {
                      return ESP_ERR_INVALID_ARG;
                  }
-                 gsmService->dce->set_mode(mode[argv[1]]);
+                 modem->setMode(mode[argv[1]]);
                  ESP_LOGI(logTag, "Modem mode set to %s", argv[1]);
                  return ESP_OK;
              },
@@ -70,7 +160,7 @@ void CommandRegistry::registerCommands() {
             {"signal", "Gets the signal strength", nullptr,
              [](int, char **) {
                  int rssi, ber;
-                 gsmService->dce->get_signal_quality(rssi, ber);
+                 modem->signalQuality(rssi, ber);
                  ESP_LOGI(logTag, "Signal strength: %d, BER: %d", rssi, ber);
                  return ESP_OK;
              },
@@ -79,7 +169,7 @@ void CommandRegistry::registerCommands() {
              [](int, char **) {
                  std::string operatorName;
                  int access;
-                 gsmService->dce->get_operator_name(operatorName, access);
+                 modem->operatorName(operatorName, access);
                  ESP_LOGI(logTag, "Operator name: %s, access: %d", operatorName.c_str(),
                           access);
                  return ESP_OK;
@@ -115,12 +205,37 @@ void CommandRegistry::registerCommands() {
             {"reset", "Resets the modem", nullptr,
              [](int, char **) {
                  std::string output;
-                 gsmService->dce->at("AT+CFUN=1,1", output, 500);
+                 modem->at("AT+CFUN=1,1", output, 500);
                  ESP_LOGI(logTag, "Modem reset");
                  return ESP_OK;
              },
              nullptr},
         };
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+        gsmCommands.push_back(
+            {"ota", "Updates the firmware or prints the update progress",
+             "[<url> <sha256>]",
+             [](int argc, char **argv) {
+                 if (argc == 1) {
+                     ota::OtaUpdater::printStatus();
+                     return ESP_OK;
+                 }
+                 if (argc != 3) {
+                     return ESP_ERR_INVALID_ARG;
+                 }
+                 return ota::OtaUpdater::start(argv[1], argv[2]) ? ESP_OK
+                                                                 : ESP_ERR_INVALID_ARG;
+             },
+             nullptr});
+#endif
+#ifdef CONFIG_EXT_CON_MQTT_ENABLE
+        gsmCommands.push_back({"mqtt", "Prints MQTT publish statistics", nullptr,
+                               [](int, char **) {
+                                   mqtt::MqttClient::printStatistics();
+                                   return ESP_OK;
+                               },
+                               nullptr});
+#endif
         commands.insert(commands.cend(), gsmCommands.begin(), gsmCommands.end());
     }
 
@@ -133,8 +248,32 @@ void CommandRegistry::registerCommands() {
                  return ESP_OK;
              },
              nullptr},
-            {"send", "Sends a message", nullptr,
-             [](int argc, char **argv) { return ESP_OK; }, nullptr},
+            {"lora", "Prints the data rate, max payload and per data rate statistics",
+             nullptr,
+             [](int, char **) {
+                 loraService->printStatistics();
+                 return ESP_OK;
+             },
+             nullptr},
+            {"send", "Sends a message", "<message>",
+             [](int argc, char **argv) {
+                 if (argc < 2) {
+                     return ESP_ERR_INVALID_ARG;
+                 }
+                 std::string message{argv[1]};
+                 for (int i = 2; i < argc; i++) {
+                     message += ' ';
+                     message += argv[i];
+                 }
+                 if (message.size() > bus::maxPayloadSize) {
+                     ESP_LOGW(logTag, "Message longer than %d bytes",
+                              bus::maxPayloadSize);
+                     return ESP_ERR_INVALID_SIZE;
+                 }
+                 bus::Topic<bus::Uplink>::publish({bus::Payload{message}});
+                 return ESP_OK;
+             },
+             nullptr},
         };
         commands.insert(commands.cend(), loraCommands.begin(), loraCommands.end());
     }
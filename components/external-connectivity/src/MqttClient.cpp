@@ -0,0 +1,247 @@
+#include "MqttClient.hpp"
+
+#include <esp_log.h>
+#include <esp_netif.h>
+#include <esp_timer.h>
+
+#include <Metrics.hpp>
+#include <Tasks.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+#include "InternalMappings.hpp"
+
+#ifdef CONFIG_EXT_CON_MQTT_ENABLE
+
+namespace {
+
+constexpr auto logTag = "mqtt";
+
+constexpr std::string_view telemetryTopic{CONFIG_EXT_CON_MQTT_TOPIC_PREFIX "/telemetry"};
+constexpr std::string_view commandTopic{CONFIG_EXT_CON_MQTT_TOPIC_PREFIX "/command/+"};
+constexpr int qos{CONFIG_EXT_CON_MQTT_QOS};
+constexpr size_t batchSize{CONFIG_EXT_CON_MQTT_BATCH_SIZE};
+constexpr size_t offlineQueueSize{CONFIG_EXT_CON_MQTT_OFFLINE_QUEUE_SIZE};
+
+// Size of a PUBLISH packet on the wire, without TCP/IP and PPP framing
+size_t packetSize(size_t payloadLength) {
+    // Topic length prefix and topic, packet identifier above QoS 0, payload
+    const size_t remaining{2 + telemetryTopic.size() + (qos > 0 ? 2 : 0) +
+                           payloadLength};
+    size_t lengthBytes{1};
+    for (auto length = remaining; length >= 128; length /= 128) {
+        lengthBytes++;
+    }
+    return 1 + lengthBytes + remaining;
+}
+
+}  // namespace
+
+namespace extcon::mqtt {
+
+using metrics::Counter;
+using metrics::Histogram;
+using metrics::Metrics;
+
+esp_mqtt_client_handle_t MqttClient::client{};
+TaskHandle_t MqttClient::flushTaskHandle{};
+std::atomic<bool> MqttClient::connected{false};
+bus::Mailbox<bus::Uplink, MqttClient::mailboxSize> MqttClient::mailbox{
+    "MQTT", Counter::MqttQueueDrops, Histogram::MqttQueueLatencyMs, 1000,
+    onUplinkQueued};
+std::mutex MqttClient::mutex;
+std::deque<std::string> MqttClient::pending;
+std::array<MqttClient::InFlight, 8> MqttClient::inFlight{};
+
+void MqttClient::start() {
+    esp_mqtt_client_config_t config{};
+    config.broker.address.uri = CONFIG_EXT_CON_MQTT_BROKER_URI;
+    client = esp_mqtt_client_init(&config);
+    ESP_ERROR_CHECK(
+        esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, onEvent, nullptr));
+    ESP_ERROR_CHECK(
+        esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, onEvent, nullptr));
+
+    flushTaskHandle = tasks::start(tasks::mqttTask, flushTask);
+    bus::Topic<bus::Uplink>::subscribe(mailbox);
+    ESP_ERROR_CHECK(esp_mqtt_client_start(client));
+    ESP_LOGI(logTag, "MQTT client started, broker: %s", CONFIG_EXT_CON_MQTT_BROKER_URI);
+}
+
+void MqttClient::onUplinkQueued() {
+    // Also while disconnected, so the mailbox drains into the offline queue
+    if (mailbox.size() >= batchSize && flushTaskHandle != nullptr) {
+        xTaskNotifyGive(flushTaskHandle);
+    }
+}
+
+void MqttClient::printStatistics() {
+    size_t queued;
+    {
+        std::lock_guard lock{mutex};
+        queued = pending.size();
+    }
+    const auto readings{Metrics::get(Counter::MqttReadings)};
+    const auto bytes{Metrics::get(Counter::MqttBytes)};
+    ESP_LOGI(logTag, "%s, %d readings queued", connected ? "Connected" : "Disconnected",
+             queued);
+    ESP_LOGI(logTag, "%lu readings in %lu publishes, %lu failed, %lu dropped offline",
+             readings, Metrics::get(Counter::MqttPublishes),
+             Metrics::get(Counter::MqttPublishFailures),
+             Metrics::get(Counter::MqttOfflineDrops));
+    ESP_LOGI(logTag, "%.1f bytes per reading at QoS %d",
+             readings > 0 ? static_cast<double>(bytes) / readings : 0.0, qos);
+    Metrics::printPercentiles("publish",
+                              Metrics::snapshot(Histogram::MqttPublishLatencyMs));
+}
+
+void MqttClient::flushTask(void *) {
+    constexpr TickType_t flushInterval{
+        pdMS_TO_TICKS(CONFIG_EXT_CON_MQTT_FLUSH_INTERVAL_MS)};
+    while (true) {
+        // Full batches go out right away, partial ones after the flush interval
+        const bool notified{ulTaskNotifyTake(pdTRUE, flushInterval) > 0};
+        collect();
+        flush(!notified);
+    }
+}
+
+void MqttClient::collect() {
+    bus::Uplink uplink;
+    std::lock_guard lock{mutex};
+    while (mailbox.pop(uplink)) {
+        if (pending.size() >= offlineQueueSize) {
+            pending.pop_front();
+            Metrics::increment(Counter::MqttOfflineDrops);
+        }
+        pending.emplace_back(uplink.payload.c_str(), uplink.payload.length());
+    }
+}
+
+void MqttClient::flush(bool partial) {
+    while (connected) {
+        std::vector<std::string> batch;
+        {
+            std::lock_guard lock{mutex};
+            if (pending.empty() || (!partial && pending.size() < batchSize)) {
+                return;
+            }
+            while (!pending.empty() && batch.size() < batchSize) {
+                batch.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+        }
+        std::string payload;
+        for (const auto &reading : batch) {
+            if (!payload.empty()) {
+                payload += '\n';
+            }
+            payload += reading;
+        }
+
+        const auto startUs{esp_timer_get_time()};
+        const auto messageId{esp_mqtt_client_publish(client, telemetryTopic.data(),
+                                                     payload.data(), payload.size(), qos,
+                                                     0)};
+        if (messageId < 0) {
+            ESP_LOGW(logTag, "Publish failed, keeping %d readings queued", batch.size());
+            Metrics::increment(Counter::MqttPublishFailures);
+            std::lock_guard lock{mutex};
+            pending.insert(pending.begin(), std::make_move_iterator(batch.begin()),
+                           std::make_move_iterator(batch.end()));
+            return;
+        }
+        Metrics::increment(Counter::MqttPublishes);
+        Metrics::increment(Counter::MqttReadings, batch.size());
+        Metrics::increment(Counter::MqttBytes, packetSize(payload.size()));
+        if constexpr (qos == 0) {
+            Metrics::record(Histogram::MqttPublishLatencyMs,
+                            (esp_timer_get_time() - startUs) / 1000);
+        } else {
+            // Latency runs until the PUBACK; a PUBACK handled before the slot is
+            // taken goes unmeasured, the oldest slot is reused when all are taken
+            std::lock_guard lock{mutex};
+            auto slot{std::min_element(
+                inFlight.begin(), inFlight.end(),
+                [](const auto &a, const auto &b) { return a.startUs < b.startUs; })};
+            *slot = {messageId, startUs};
+        }
+    }
+}
+
+void MqttClient::onEvent(void *, esp_event_base_t base, int32_t eventId,
+                         void *eventData) {
+    if (base == IP_EVENT) {
+        if (eventId == IP_EVENT_PPP_LOST_IP) {
+            connected = false;
+            ESP_LOGW(logTag, "PPP link lost, queueing readings");
+        } else if (eventId == IP_EVENT_PPP_GOT_IP) {
+            esp_mqtt_client_reconnect(client);
+        }
+        return;
+    }
+
+    const auto event{static_cast<esp_mqtt_event_handle_t>(eventData)};
+    switch (static_cast<esp_mqtt_event_id_t>(eventId)) {
+        case MQTT_EVENT_CONNECTED:
+            ESP_LOGI(logTag, "Connected to broker");
+            connected = true;
+            esp_mqtt_client_subscribe(client, commandTopic.data(), 1);
+            // Send what was queued while offline
+            xTaskNotifyGive(flushTaskHandle);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            ESP_LOGW(logTag, "Disconnected from broker");
+            connected = false;
+            break;
+        case MQTT_EVENT_PUBLISHED: {
+            std::lock_guard lock{mutex};
+            const auto slot{std::find_if(
+                inFlight.begin(), inFlight.end(),
+                [event](const auto &slot) { return slot.messageId == event->msg_id; })};
+            if (slot != inFlight.end() && slot->startUs > 0) {
+                Metrics::record(Histogram::MqttPublishLatencyMs,
+                                (esp_timer_get_time() - slot->startUs) / 1000);
+                *slot = {};
+            }
+            break;
+        }
+        case MQTT_EVENT_DATA:
+            if (event->current_data_offset != 0 ||
+                event->data_len != event->total_data_len) {
+                ESP_LOGW(logTag, "Ignoring fragmented command of %d bytes",
+                         event->total_data_len);
+                break;
+            }
+            onCommand({event->topic, static_cast<size_t>(event->topic_len)},
+                      {event->data, static_cast<size_t>(event->data_len)});
+            break;
+        default:
+            break;
+    }
+}
+
+void MqttClient::onCommand(std::string_view topic, std::string_view data) {
+    const std::string portString{topic.substr(topic.rfind('/') + 1)};
+    char *end;
+    const auto port{std::strtoul(portString.c_str(), &end, 10)};
+    // LoRaWAN application ports, checked before `port_t` would truncate the number
+    if (end == portString.c_str() || *end != '\0' || port < 1 || port > 223 ||
+        !portToUuid.contains(port)) {
+        ESP_LOGW(logTag, "Ignoring command on topic %.*s", topic.size(), topic.data());
+        return;
+    }
+    if (data.size() > bus::maxPayloadSize) {
+        ESP_LOGW(logTag, "Command too long: %d bytes", data.size());
+        Metrics::increment(Counter::AllocationFailures);
+        return;
+    }
+    bus::Topic<bus::PeripheralWrite>::publish({portToUuid.at(port), bus::Payload{data}});
+}
+
+}  // namespace extcon::mqtt
+
+#endif
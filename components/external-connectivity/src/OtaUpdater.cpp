@@ -0,0 +1,304 @@
+#include "OtaUpdater.hpp"
+
+#include <esp_log.h>
+#include <esp_netif.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <sdkconfig.h>
+
+#include <Tasks.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <strings.h>
+
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+
+namespace {
+
+constexpr auto logTag = "ota";
+
+constexpr uint32_t maxRetries{CONFIG_EXT_CON_OTA_RETRIES};
+#if CONFIG_EXT_CON_OTA_MAX_RATE > 0
+constexpr uint32_t maxRateBytesPerSecond{CONFIG_EXT_CON_OTA_MAX_RATE * 1024};
+#endif
+
+// Flash is written in the chunks read from the connection
+std::array<char, 1024> chunk;
+// Content-Range header of the last response
+std::array<char, 64> contentRange;
+
+bool parseHash(std::string_view hex, std::array<uint8_t, 32> &hash) {
+    if (hex.size() != 2 * hash.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < hash.size(); i++) {
+        const char byte[]{hex[2 * i], hex[2 * i + 1], '\0'};
+        char *end;
+        hash[i] = static_cast<uint8_t>(std::strtoul(byte, &end, 16));
+        if (end != byte + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Connection and transport errors; a server without range support or a flash write
+// failure will not go away by retrying
+bool isRetryable(esp_err_t result) {
+    return result == ESP_FAIL ||
+           (result >= ESP_ERR_HTTP_BASE && result < ESP_ERR_HTTP_BASE + 0x100);
+}
+
+esp_err_t onHttpEvent(esp_http_client_event_t *event) {
+    if (event->event_id == HTTP_EVENT_ON_HEADER &&
+        strcasecmp(event->header_key, "Content-Range") == 0) {
+        snprintf(contentRange.data(), contentRange.size(), "%s", event->header_value);
+    }
+    return ESP_OK;
+}
+
+// A resumed download has to continue where the last one stopped, a server may send
+// another range than requested, e.g. from a cache
+bool rangeStartsAt(const char *range, uint32_t offset) {
+    unsigned long first;
+    return std::sscanf(range, "bytes %lu-", &first) == 1 && first == offset;
+}
+
+}  // namespace
+
+namespace extcon::ota {
+
+std::string OtaUpdater::url{};
+std::array<uint8_t, 32> OtaUpdater::expectedHash{};
+std::atomic<State> OtaUpdater::state{State::Idle};
+std::atomic<uint32_t> OtaUpdater::written{0};
+std::atomic<uint32_t> OtaUpdater::imageSize{0};
+int64_t OtaUpdater::startUs{0};
+int64_t OtaUpdater::endUs{0};
+esp_ota_handle_t OtaUpdater::handle{};
+mbedtls_sha256_context OtaUpdater::hash{};
+
+bool OtaUpdater::start(const std::string &imageUrl, const std::string &sha256) {
+    if (state == State::Downloading || state == State::Verifying) {
+        ESP_LOGW(logTag, "An update is already in progress");
+        return false;
+    }
+    if (!parseHash(sha256, expectedHash)) {
+        ESP_LOGE(logTag, "Invalid SHA-256 digest: %s", sha256.c_str());
+        return false;
+    }
+    url = imageUrl;
+    written = 0;
+    imageSize = 0;
+    state = State::Downloading;
+    tasks::start(tasks::otaTask, task);
+    return true;
+}
+
+void OtaUpdater::printStatus() {
+    constexpr std::array stateNames{
+        "idle", "downloading", "verifying", "done", "failed",
+    };
+    const auto elapsedUs{(state == State::Done || state == State::Failed
+                              ? endUs
+                              : esp_timer_get_time()) -
+                         startUs};
+    const double elapsedS{startUs > 0 ? elapsedUs / 1e6 : 0.0};
+    ESP_LOGI(logTag, "%s, %lu of %lu bytes in %.1f s (%.1f kB/s)",
+             stateNames[static_cast<size_t>(state.load())], written.load(),
+             imageSize.load(), elapsedS,
+             elapsedS > 0 ? written.load() / 1024.0 / elapsedS : 0.0);
+}
+
+void OtaUpdater::confirmOnConnectivity() {
+    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_PPP_GOT_IP,
+                                               onGotIp, nullptr));
+}
+
+void OtaUpdater::confirmImage() {
+    const auto running{esp_ota_get_running_partition()};
+    esp_ota_img_states_t imageState;
+    if (esp_ota_get_state_partition(running, &imageState) == ESP_OK &&
+        imageState == ESP_OTA_IMG_PENDING_VERIFY) {
+        ESP_LOGI(logTag, "First boot of the updated image, confirming it");
+        esp_ota_mark_app_valid_cancel_rollback();
+    }
+}
+
+void OtaUpdater::onGotIp(void *, esp_event_base_t, int32_t, void *) {
+    confirmImage();
+}
+
+void OtaUpdater::task(void *) {
+    if (update()) {
+        ESP_LOGI(logTag, "Restarting into the new image");
+        vTaskDelay(pdMS_TO_TICKS(5000));
+        esp_restart();
+    }
+    vTaskDelete(nullptr);
+}
+
+bool OtaUpdater::update() {
+    const auto partition{esp_ota_get_next_update_partition(nullptr)};
+    if (partition == nullptr) {
+        ESP_LOGE(logTag, "No OTA partition to update");
+        state = State::Failed;
+        return false;
+    }
+    // Sequential writes erase each sector right before writing it, instead of the
+    // whole partition up front
+    if (const auto result{esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &handle)};
+        result != ESP_OK) {
+        ESP_LOGE(logTag, "Failed to begin update: %s", esp_err_to_name(result));
+        state = State::Failed;
+        return false;
+    }
+    mbedtls_sha256_init(&hash);
+    mbedtls_sha256_starts(&hash, 0);
+    ESP_LOGI(logTag, "Downloading %s to partition %s", url.c_str(), partition->label);
+
+    startUs = esp_timer_get_time();
+    esp_err_t result{ESP_FAIL};
+    uint32_t retries{0};
+    while (true) {
+        const auto writtenBefore{written.load()};
+        result = download();
+        if (!isRetryable(result)) {
+            break;
+        }
+        // Only attempts without progress count against the retry limit
+        retries = written > writtenBefore ? 0 : retries + 1;
+        if (retries > maxRetries) {
+            break;
+        }
+        ESP_LOGW(logTag, "Download interrupted at %lu of %lu bytes, resuming in 10 s",
+                 written.load(), imageSize.load());
+        vTaskDelay(pdMS_TO_TICKS(10000));
+    }
+    const auto downloadUs{esp_timer_get_time() - startUs};
+
+    state = State::Verifying;
+    std::array<uint8_t, 32> actualHash;
+    mbedtls_sha256_finish(&hash, actualHash.data());
+    mbedtls_sha256_free(&hash);
+    if (result != ESP_OK || actualHash != expectedHash) {
+        ESP_LOGE(logTag, "%s", result != ESP_OK ? "Download failed" : "Hash mismatch");
+        esp_ota_abort(handle);
+        state = State::Failed;
+        endUs = esp_timer_get_time();
+        return false;
+    }
+    // Also checks the image header and the checksum appended by the build
+    if (const auto endResult{esp_ota_end(handle)}; endResult != ESP_OK) {
+        ESP_LOGE(logTag, "Invalid image: %s", esp_err_to_name(endResult));
+        state = State::Failed;
+        endUs = esp_timer_get_time();
+        return false;
+    }
+    if (const auto bootResult{esp_ota_set_boot_partition(partition)};
+        bootResult != ESP_OK) {
+        ESP_LOGE(logTag, "Failed to set boot partition: %s",
+                 esp_err_to_name(bootResult));
+        state = State::Failed;
+        endUs = esp_timer_get_time();
+        return false;
+    }
+    state = State::Done;
+    endUs = esp_timer_get_time();
+
+    ESP_LOGI(logTag, "Downloaded %lu bytes in %.1f s (%.1f kB/s)", written.load(),
+             downloadUs / 1e6, written.load() / 1024.0 / (downloadUs / 1e6));
+    ESP_LOGI(logTag, "Time to update: %.1f s", (endUs - startUs) / 1e6);
+    return true;
+}
+
+esp_err_t OtaUpdater::download() {
+    esp_http_client_config_t config{
+        .url = url.c_str(),
+        .timeout_ms = 30000,
+        .event_handler = onHttpEvent,
+    };
+    auto client{esp_http_client_init(&config)};
+    // Out of memory or a malformed URL, retried like a failed connection
+    if (client == nullptr) {
+        ESP_LOGE(logTag, "Failed to initialize the HTTP client");
+        return ESP_FAIL;
+    }
+    const auto offset{written.load()};
+    if (offset > 0) {
+        char range[24];
+        snprintf(range, sizeof(range), "bytes=%lu-", offset);
+        esp_http_client_set_header(client, "Range", range);
+    }
+
+    contentRange[0] = '\0';
+    auto result{esp_http_client_open(client, 0)};
+    if (result != ESP_OK) {
+        ESP_LOGE(logTag, "Failed to connect: %s", esp_err_to_name(result));
+        esp_http_client_cleanup(client);
+        return result;
+    }
+    const auto contentLength{esp_http_client_fetch_headers(client)};
+    const auto statusCode{esp_http_client_get_status_code(client)};
+    if (offset > 0 && statusCode != 206) {
+        ESP_LOGE(logTag, "Server does not support ranges, status code: %d", statusCode);
+        result = ESP_ERR_NOT_SUPPORTED;
+    } else if (offset > 0 && !rangeStartsAt(contentRange.data(), offset)) {
+        ESP_LOGE(logTag, "Response does not resume at byte %lu, range: %s", offset,
+                 contentRange.data());
+        result = ESP_ERR_INVALID_RESPONSE;
+    } else if (offset == 0 && (statusCode != 200 || contentLength <= 0)) {
+        ESP_LOGE(logTag, "Unexpected response, status code: %d, content length: %lld",
+                 statusCode, contentLength);
+        result = ESP_ERR_NOT_SUPPORTED;
+    }
+    if (result != ESP_OK) {
+        esp_http_client_cleanup(client);
+        return result;
+    }
+    if (offset == 0) {
+        imageSize = contentLength;
+    }
+
+    while (written < imageSize) {
+        const auto length{esp_http_client_read(client, chunk.data(), chunk.size())};
+        if (length <= 0) {
+            ESP_LOGW(logTag, "Connection lost");
+            result = ESP_FAIL;
+            break;
+        }
+        result = esp_ota_write(handle, chunk.data(), length);
+        if (result != ESP_OK) {
+            ESP_LOGE(logTag, "Failed to write image: %s", esp_err_to_name(result));
+            break;
+        }
+        mbedtls_sha256_update(&hash, reinterpret_cast<const uint8_t *>(chunk.data()),
+                              length);
+        written += length;
+        throttle();
+    }
+    esp_http_client_cleanup(client);
+    return result;
+}
+
+void OtaUpdater::throttle() {
+#if CONFIG_EXT_CON_OTA_MAX_RATE > 0
+    // Pace the average rate, so HTTP telemetry over the same PPP link is not starved
+    const auto earliestUs{startUs + written * 1000000LL / maxRateBytesPerSecond};
+    const auto nowUs{esp_timer_get_time()};
+    if (earliestUs > nowUs) {
+        const TickType_t delay{pdMS_TO_TICKS((earliestUs - nowUs) / 1000)};
+        vTaskDelay(std::max<TickType_t>(delay, 1));
+        return;
+    }
+#endif
+    // Let tasks of the same priority run between chunks
+    taskYIELD();
+}
+
+}  // namespace extcon::ota
+
+#endif
@@ -0,0 +1,138 @@
+#include "Pipeline.hpp"
+
+#include <Aggregator.hpp>
+#include <DeferredLog.hpp>
+#include <Metrics.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <optional>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nimble/nimble_port.h"
+#include "sdkconfig.h"
+
+#ifdef CONFIG_EXT_CON_DEBUG_LOGGING
+#undef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
+#endif
+
+namespace {
+
+using extcon::metrics::Counter;
+using extcon::metrics::Histogram;
+using extcon::metrics::Metrics;
+
+constexpr auto logTag{"pipeline"};
+
+std::optional<extcon::telemetry::Aggregator> aggregator;
+#ifdef CONFIG_EXT_CON_AGGREGATION_ENABLE
+ble_npl_callout aggregationCallout;
+#endif
+
+// Writes arrive from other tasks and are handed over to the host task by this event
+ble_npl_event writeEvent;
+extcon::bus::Mailbox<extcon::bus::PeripheralWrite, 8> writeMailbox{
+    "Peripheral write", Counter::BusDrops, Histogram::BleWriteLatencyUs, 1,
+    [] { ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &writeEvent); }};
+
+}  // namespace
+
+namespace extcon::telemetry {
+
+using tracing::Stage;
+using tracing::Trace;
+
+ble::PeripheralLink *Pipeline::link{};
+
+void Pipeline::init(ble::PeripheralLink &peripheralLink) {
+    link = &peripheralLink;
+    ble_npl_event_init(&writeEvent, onWriteRequests, nullptr);
+    bus::Topic<bus::PeripheralWrite>::subscribe(writeMailbox);
+
+#ifdef CONFIG_EXT_CON_AGGREGATION_ENABLE
+#ifdef CONFIG_EXT_CON_AGGREGATION_VARIANCE
+    constexpr bool withVariance{true};
+#else
+    constexpr bool withVariance{false};
+#endif
+    aggregator.emplace(CONFIG_EXT_CON_AGGREGATION_WINDOW_MS, withVariance,
+                       [](Uuid uuid, std::string_view summary) {
+                           uplink(uuid, summary, {});
+                       });
+    ble_npl_callout_init(&aggregationCallout, nimble_port_get_dflt_eventq(),
+                         onAggregationTimer, nullptr);
+    onAggregationTimer(nullptr);
+#endif
+}
+
+void Pipeline::onWriteRequests(ble_npl_event *) {
+    bus::PeripheralWrite request;
+    while (writeMailbox.pop(request)) {
+        link->writeValue(request.uuid, {request.value.c_str(), request.value.length()});
+    }
+}
+
+#ifdef CONFIG_EXT_CON_AGGREGATION_ENABLE
+void Pipeline::onAggregationTimer(ble_npl_event *) {
+    const auto nowMs{esp_timer_get_time() / 1000};
+    aggregator->flush(nowMs);
+
+    // Fire right after the next window boundary so summaries are not delayed until
+    // the next sample of the series arrives
+    constexpr uint32_t windowMs{CONFIG_EXT_CON_AGGREGATION_WINDOW_MS};
+    const uint32_t delayMs = windowMs - nowMs % windowMs;
+    ble_npl_callout_reset(&aggregationCallout, ble_npl_time_ms_to_ticks32(delayMs));
+}
+#endif
+
+void Pipeline::forwardValue(Uuid uuid, std::string_view value, Trace trace) {
+    char number[32];
+    if (aggregator.has_value() && value.size() < sizeof(number)) {
+        *std::copy(value.begin(), value.end(), number) = '\0';
+        char *end;
+        const auto parsed{std::strtof(number, &end)};
+        if (end != number && *end == '\0' &&
+            aggregator->add(uuid, parsed, esp_timer_get_time() / 1000)) {
+            return;
+        }
+    }
+    uplink(uuid, value, trace);
+}
+
+std::string_view Pipeline::format(Uuid uuid, std::string_view value,
+                                  MessageBuffer &buffer) {
+    const auto type{uuidToType.find(uuid)};
+    if (type == uuidToType.end()) {
+        return {};
+    }
+    const auto result{std::format_to_n(buffer.data(), buffer.size() - 1, "{}={}",
+                                       type->second, value)};
+    if (result.size >= static_cast<ptrdiff_t>(buffer.size())) {
+        return {};
+    }
+    *result.out = '\0';
+    return {buffer.data(), static_cast<size_t>(result.size)};
+}
+
+void Pipeline::uplink(Uuid uuid, std::string_view value, Trace trace) {
+    if (!uuidToType.contains(uuid)) {
+        ESP_LOGW(logTag, "UUID not found in mapping: 0x%02X", uuid);
+        return;
+    }
+    MessageBuffer buffer;
+    const auto message{format(uuid, value, buffer)};
+    if (message.empty()) {
+        ESP_LOGW(logTag, "Message too long for type: %s", uuidToType.at(uuid).c_str());
+        Metrics::increment(Counter::AllocationFailures);
+        return;
+    }
+    trace.stamp(Stage::Encode);
+    EXT_CON_LOGD(logTag, "Sending message: %s", message.data());
+    trace.stamp(Stage::Enqueue);
+    // Subscribers with a full mailbox count and log the drop themselves
+    bus::Topic<bus::Uplink>::publish({bus::Payload{message}, bus::uplinkPort, trace});
+}
+
+}  // namespace extcon::telemetry
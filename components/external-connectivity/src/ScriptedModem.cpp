@@ -0,0 +1,90 @@
+#include "ScriptedModem.hpp"
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+namespace extcon::gsm {
+
+constexpr auto logTag = "gsm";
+
+ScriptedModem::ScriptedModem(std::vector<Exchange> script) : script{std::move(script)} {
+}
+
+bool ScriptedModem::setMode(ModemMode mode) {
+    if (mode == currentMode) {
+        return true;
+    }
+    std::string response;
+    if (mode == ModemMode::Data) {
+        if (!exchange("ATD*99#", response, 5000) ||
+            response.compare(0, 7, "CONNECT") != 0) {
+            return false;
+        }
+    } else if (!exchange("+++", response, 1000)) {
+        return false;
+    }
+    currentMode = mode;
+    return true;
+}
+
+bool ScriptedModem::at(const std::string &command, std::string &response,
+                       uint32_t timeoutMs) {
+    if (currentMode == ModemMode::Data) {
+        ESP_LOGW(logTag, "AT command in data mode: %s", command.c_str());
+        return false;
+    }
+    return exchange(command, response, timeoutMs);
+}
+
+bool ScriptedModem::signalQuality(int &rssi, int &ber) {
+    std::string response;
+    return at("AT+CSQ", response, 500) &&
+           std::sscanf(response.c_str(), "+CSQ: %d,%d", &rssi, &ber) == 2;
+}
+
+bool ScriptedModem::operatorName(std::string &name, int &access) {
+    // +COPS: <mode>,<format>,"<operator>",<access technology>
+    std::string response;
+    if (!at("AT+COPS?", response, 500)) {
+        return false;
+    }
+    const auto open{response.find('"')};
+    const auto close{response.rfind('"')};
+    if (open == std::string::npos || close == open) {
+        return false;
+    }
+    name = response.substr(open + 1, close - open - 1);
+    access = close + 2 < response.size() ? std::atoi(response.c_str() + close + 2) : 0;
+    return true;
+}
+
+ModemMode ScriptedModem::mode() const {
+    return currentMode;
+}
+
+size_t ScriptedModem::pending() const {
+    return script.size() - next;
+}
+
+bool ScriptedModem::exchange(const std::string &command, std::string &response,
+                             uint32_t timeoutMs) {
+    if (next >= script.size() || script[next].command != command) {
+        ESP_LOGW(logTag, "Unexpected command: %s", command.c_str());
+        return false;
+    }
+    const auto &scripted{script[next++]};
+    if (scripted.delayMs > timeoutMs) {
+        vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+        ESP_LOGW(logTag, "Command timed out: %s", command.c_str());
+        return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(scripted.delayMs));
+    response = scripted.response;
+    return response != "ERROR";
+}
+
+}  // namespace extcon::gsm
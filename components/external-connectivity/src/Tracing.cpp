@@ -0,0 +1,91 @@
+#include "Tracing.hpp"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+namespace extcon::tracing {
+
+constexpr auto logTag = "trace";
+
+#ifdef CONFIG_EXT_CON_TRACING_ENABLE
+
+constexpr std::array<const char *, static_cast<size_t>(Stage::Count)> stageNames{
+    "rx", "encode", "enqueue", "dequeue", "tx_start", "tx_done",
+};
+
+decltype(Tracer::ring) Tracer::ring{};
+uint32_t Tracer::recorded{0};
+
+void Tracer::record(const Trace &trace) {
+    ring[recorded % ring.size()] = trace;
+    recorded++;
+}
+
+void Tracer::printPercentiles() {
+    const auto count{std::min<size_t>(recorded, ring.size())};
+    ESP_LOGI(logTag, "%d traces, latency in ms: p50 p90 p99 max", count);
+
+    std::vector<uint32_t> latenciesUs;
+    latenciesUs.reserve(count);
+    const auto printSegment{[&](size_t from, size_t to) {
+        latenciesUs.clear();
+        for (size_t i = 0; i < count; i++) {
+            const auto &timestamps{ring[i].timestampsUs};
+            if (timestamps[from] != 0 && timestamps[to] != 0) {
+                latenciesUs.push_back(timestamps[to] - timestamps[from]);
+            }
+        }
+        if (latenciesUs.empty()) {
+            return;
+        }
+        std::sort(latenciesUs.begin(), latenciesUs.end());
+        const auto percentile{[&](size_t percent) {
+            return latenciesUs[(latenciesUs.size() - 1) * percent / 100] / 1000.0;
+        }};
+        ESP_LOGI(logTag, "%8s -> %-8s %8.1f %8.1f %8.1f %8.1f", stageNames[from],
+                 stageNames[to], percentile(50), percentile(90), percentile(99),
+                 latenciesUs.back() / 1000.0);
+    }};
+
+    for (size_t stage = 0; stage + 1 < stageNames.size(); stage++) {
+        printSegment(stage, stage + 1);
+    }
+    printSegment(static_cast<size_t>(Stage::Receive),
+                 static_cast<size_t>(Stage::TransmitDone));
+    printSegment(static_cast<size_t>(Stage::Enqueue),
+                 static_cast<size_t>(Stage::TransmitDone));
+}
+
+void Tracer::dump() {
+    const auto count{std::min<size_t>(recorded, ring.size())};
+    printf("trace,sequence");
+    for (const auto name : stageNames) {
+        printf(",%s", name);
+    }
+    printf("\n");
+    for (uint32_t sequence = recorded - count; sequence < recorded; sequence++) {
+        printf("trace,%" PRIu32, sequence);
+        for (const auto timestamp : ring[sequence % ring.size()].timestampsUs) {
+            printf(",%" PRIu32, timestamp);
+        }
+        printf("\n");
+    }
+}
+
+#else
+
+void Tracer::printPercentiles() {
+    ESP_LOGW(logTag, "Tracing is disabled");
+}
+
+void Tracer::dump() {
+    ESP_LOGW(logTag, "Tracing is disabled");
+}
+
+#endif
+
+}  // namespace extcon::tracing
@@ -0,0 +1,167 @@
+#include "TtnLoraMac.hpp"
+
+#include <driver/gpio.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include <nvs.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace extcon::lora {
+
+constexpr auto logTag = "lora";
+constexpr auto nvsNamespace = "extcon";
+constexpr auto nvsKeyFingerprint = "lora_keys";
+
+// EU868 data rates by index, LoRaWAN Regional Parameters RP002
+constexpr std::array eu868DataRates{
+    kTTNDataRate_EU868_SF12,
+    kTTNDataRate_EU868_SF11,
+    kTTNDataRate_EU868_SF10,
+    kTTNDataRate_EU868_SF9,
+    kTTNDataRate_EU868_SF8,
+    kTTNDataRate_EU868_SF7,
+    kTTNDataRate_EU868_SF7_BW250,
+    kTTNDataRate_EU868_FSK,
+};
+
+// Uplinks of the session not yet saved to flash, kept across every reset but a power
+// loss. RTC_DATA_ATTR would not do: the bootloader reloads it on every reset other than
+// a deep sleep wake-up, as it does for the session copy of ttn-esp32 in RTC memory.
+struct RtcSessionState {
+    uint32_t magic;
+    uint32_t keyFingerprint;
+    uint32_t unsavedUplinks;
+    uint32_t crc;
+};
+
+constexpr uint32_t rtcSessionMagic{0x4c6f5261};
+RTC_NOINIT_ATTR RtcSessionState rtcSession;
+
+uint32_t rtcSessionCrc() {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&rtcSession),
+                            offsetof(RtcSessionState, crc));
+}
+
+bool rtcSessionValid(uint32_t keyFingerprint) {
+    return rtcSession.magic == rtcSessionMagic && rtcSession.crc == rtcSessionCrc() &&
+           rtcSession.keyFingerprint == keyFingerprint;
+}
+
+void writeRtcSession(uint32_t keyFingerprint, uint32_t unsavedUplinks) {
+    rtcSession = {rtcSessionMagic, keyFingerprint, unsavedUplinks, 0};
+    rtcSession.crc = rtcSessionCrc();
+}
+
+bool TtnLoraMac::init(const std::string &devEui, const std::string &appEui,
+                      const std::string &appKey) {
+    spi_bus_config_t busConfig{};
+    busConfig.mosi_io_num = GPIO_NUM_27;
+    busConfig.miso_io_num = GPIO_NUM_19;
+    busConfig.sclk_io_num = GPIO_NUM_5;
+    ESP_ERROR_CHECK(spi_bus_initialize(HSPI_HOST, &busConfig, SPI_DMA_DISABLED));
+
+    ttn.configurePins(HSPI_HOST, GPIO_NUM_18, TTN_NOT_CONNECTED, GPIO_NUM_23,
+                      GPIO_NUM_26, GPIO_NUM_33);
+    keyFingerprint = LoraMac::keyFingerprint(devEui, appEui, appKey);
+    return ttn.provision(devEui.c_str(), appEui.c_str(), appKey.c_str());
+}
+
+bool TtnLoraMac::join() {
+    return ttn.join();
+}
+
+TTNResponseCode TtnLoraMac::transmitMessage(const uint8_t *payload, size_t length,
+                                            port_t port, bool confirm) {
+    return ttn.transmitMessage(payload, length, port, confirm);
+}
+
+void TtnLoraMac::onMessage(TTNMessageCallback callback) {
+    ttn.onMessage(callback);
+}
+
+void TtnLoraMac::setAdrEnabled(bool enabled) {
+    ttn.setAdrEnabled(enabled);
+}
+
+void TtnLoraMac::setDataRate(uint8_t dataRate) {
+    txDataRate = std::min<uint8_t>(dataRate, eu868DataRates.size() - 1);
+    ttn.setDataRate(eu868DataRates[txDataRate]);
+}
+
+void TtnLoraMac::setMaxTxPower(int8_t power) {
+    ttn.setMaxTxPower(power);
+}
+
+uint8_t TtnLoraMac::dataRate() {
+    return txDataRate;
+}
+
+bool TtnLoraMac::resumeSession() {
+    if (savedKeyFingerprint() != keyFingerprint) {
+        ESP_LOGI(logTag, "No saved session for the configured keys");
+        return false;
+    }
+    // After a reset RTC memory tells whether uplinks were sent since the session was
+    // saved, in which case the network would drop uplinks with the older frame counter
+    // of the saved one. After a power loss that is unknown and the session is resumed.
+    // The power-off duration is unknown as well, so duty cycle limits are applied as if
+    // no time had passed.
+    if (rtcSessionValid(keyFingerprint) && rtcSession.unsavedUplinks > 0) {
+        ESP_LOGW(logTag, "Saved session lags %lu uplinks behind",
+                 rtcSession.unsavedUplinks);
+        return false;
+    }
+    if (!ttn.resumeAfterPowerOff(0)) {
+        return false;
+    }
+    writeRtcSession(keyFingerprint, 0);
+    ESP_LOGI(logTag, "Session resumed from NVS");
+    return true;
+}
+
+bool TtnLoraMac::saveSession(bool durable) {
+    if (!durable) {
+        const bool counting{rtcSessionValid(keyFingerprint)};
+        writeRtcSession(keyFingerprint, counting ? rtcSession.unsavedUplinks + 1 : 1);
+        return true;
+    }
+    // ttn-esp32 only saves the session when preparing for power off, which stops the
+    // stack, so it is resumed right away
+    ttn.prepareForPowerOff();
+    if (!ttn.resumeAfterPowerOff(0)) {
+        return false;
+    }
+    saveKeyFingerprint(keyFingerprint);
+    writeRtcSession(keyFingerprint, 0);
+    return true;
+}
+
+uint32_t TtnLoraMac::savedKeyFingerprint() {
+    nvs_handle_t handle;
+    uint32_t fingerprint{0};
+    if (nvs_open(nvsNamespace, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u32(handle, nvsKeyFingerprint, &fingerprint);
+        nvs_close(handle);
+    }
+    return fingerprint;
+}
+
+void TtnLoraMac::saveKeyFingerprint(uint32_t fingerprint) {
+    nvs_handle_t handle;
+    if (nvs_open(nvsNamespace, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGE(logTag, "Failed to open NVS for the key fingerprint");
+        return;
+    }
+    // NVS skips the write when the value is unchanged
+    if (nvs_set_u32(handle, nvsKeyFingerprint, fingerprint) != ESP_OK ||
+        nvs_commit(handle) != ESP_OK) {
+        ESP_LOGE(logTag, "Failed to save the key fingerprint");
+    }
+    nvs_close(handle);
+}
+
+}  // namespace extcon::lora
@@ -0,0 +1,117 @@
+#include "VirtualPeripheral.hpp"
+
+#include <Pipeline.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <limits>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+
+namespace {
+
+constexpr auto logTag{"vperiph"};
+
+ble_npl_callout callout;
+
+}  // namespace
+
+namespace extcon::ble {
+
+std::vector<VirtualPeripheral::Stream> VirtualPeripheral::streams;
+std::atomic<uint32_t> VirtualPeripheral::emittedValues{0};
+std::atomic<uint32_t> VirtualPeripheral::writtenValues{0};
+
+VirtualPeripheral::VirtualPeripheral(const std::string &script) {
+    size_t start{0};
+    while (start < script.size()) {
+        auto end{script.find(',', start)};
+        if (end == std::string::npos) {
+            end = script.size();
+        }
+        const auto entry{script.substr(start, end - start)};
+        start = end + 1;
+
+        const auto separator{entry.find(':')};
+        const auto name{entry.substr(0, separator)};
+        const auto type{
+            std::find_if(uuidToType.begin(), uuidToType.end(),
+                         [&name](const auto &pair) { return pair.second == name; })};
+        const auto rateHz{separator == std::string::npos
+                              ? 0.0f
+                              : std::strtof(entry.c_str() + separator + 1, nullptr)};
+        if (type == uuidToType.end() || rateHz <= 0) {
+            ESP_LOGW(logTag, "Invalid script entry: %s", entry.c_str());
+            continue;
+        }
+        const auto periodMs{static_cast<uint32_t>(std::max(1.0f, 1000 / rateHz))};
+        streams.push_back({type->first, periodMs, 0, 0});
+    }
+}
+
+bool VirtualPeripheral::init() {
+    // Only the event queue of the NimBLE port is used, there is no BLE connection
+    ESP_ERROR_CHECK(nimble_port_init());
+    ble_npl_callout_init(&callout, nimble_port_get_dflt_eventq(), onTimer, nullptr);
+    return true;
+}
+
+void VirtualPeripheral::start() {
+    ESP_LOGI(logTag, "Starting virtual peripheral with %d streams", streams.size());
+    // Values are emitted on the NimBLE host task like real notifications
+    ble_npl_callout_reset(&callout, 0);
+    nimble_port_freertos_init(loop);
+}
+
+void VirtualPeripheral::writeValue(Uuid uuid, std::string_view value) {
+    writtenValues.fetch_add(1, std::memory_order_relaxed);
+    ESP_LOGI(logTag, "Write to 0x%02X: %.*s", uuid, value.size(), value.data());
+}
+
+uint32_t VirtualPeripheral::emitted() {
+    return emittedValues.load(std::memory_order_relaxed);
+}
+
+uint32_t VirtualPeripheral::written() {
+    return writtenValues.load(std::memory_order_relaxed);
+}
+
+void VirtualPeripheral::loop(void *) {
+    nimble_port_run();
+    nimble_port_freertos_deinit();
+}
+
+void VirtualPeripheral::onTimer(ble_npl_event *) {
+    const auto nowMs{esp_timer_get_time() / 1000};
+    auto nextDueMs{std::numeric_limits<int64_t>::max()};
+    for (auto &stream : streams) {
+        if (stream.nextDueMs <= nowMs) {
+            // Slow sine wave so that aggregated statistics are meaningful
+            tracing::Trace trace{};
+            trace.stamp(tracing::Stage::Receive);
+            const auto value{10 + 5 * std::sin(stream.sequence++ * 0.1)};
+            char buffer[16];
+            const auto result{std::format_to_n(buffer, sizeof(buffer), "{:.2f}", value)};
+            telemetry::Pipeline::forwardValue(
+                stream.uuid, {buffer, static_cast<size_t>(result.out - buffer)}, trace);
+            emittedValues.fetch_add(1, std::memory_order_relaxed);
+            stream.nextDueMs += stream.periodMs;
+            if (stream.nextDueMs <= nowMs) {
+                stream.nextDueMs = nowMs + stream.periodMs;
+            }
+        }
+        nextDueMs = std::min(nextDueMs, stream.nextDueMs);
+    }
+    if (streams.empty()) {
+        return;
+    }
+    const auto delayMs{static_cast<uint32_t>(std::max<int64_t>(nextDueMs - nowMs, 1))};
+    ble_npl_callout_reset(&callout, ble_npl_time_ms_to_ticks32(delayMs));
+}
+
+}  // namespace extcon::ble
@@ -5,10 +5,15 @@
 #include <sdkconfig.h>
 
 #include <BleService.hpp>
+#include <DeferredLog.hpp>
 #include <GsmService.hpp>
 #include <HttpClient.hpp>
 #include <LoraService.hpp>
 #include <ModemConsole.hpp>
+#include <MqttClient.hpp>
+#include <OtaUpdater.hpp>
+#include <Pipeline.hpp>
+#include <VirtualPeripheral.hpp>
 
 using namespace extcon;
 
@@ -17,23 +22,40 @@ constexpr auto logTag = "main";
 std::unique_ptr<gsm::GsmService> gsmService;
 std::unique_ptr<http::HttpClient> httpClient;
 std::unique_ptr<lora::LoraService> loraService;
-std::unique_ptr<ble::BleService> bleService;
+std::unique_ptr<ble::PeripheralLink> peripheralLink;
 
 extern "C" void app_main(void) {
     ESP_ERROR_CHECK(gpio_install_isr_service(ESP_INTR_FLAG_IRAM));
     ESP_ERROR_CHECK(nvs_flash_init());
+#ifdef CONFIG_EXT_CON_DEFERRED_LOGGING
+    logging::DeferredLog::start();
+#endif
 
-    bleService = std::make_unique<ble::BleService>();
-    if (!bleService->init()) {
+#ifdef CONFIG_EXT_CON_BLE_VIRTUAL_PERIPHERAL
+    peripheralLink = std::make_unique<ble::VirtualPeripheral>(
+        CONFIG_EXT_CON_BLE_VIRTUAL_PERIPHERAL_SCRIPT);
+#else
+    peripheralLink = std::make_unique<ble::BleService>();
+#endif
+    if (!peripheralLink->init()) {
         ESP_LOGE(logTag, "BLE service failed to initialize.");
         return;
     }
-    bleService->start();
+    telemetry::Pipeline::init(*peripheralLink);
+    peripheralLink->start();
 
 #ifdef CONFIG_EXT_CON_GSM_ENABLE
     gsmService = std::make_unique<gsm::GsmService>(CONFIG_EXT_CON_APN);
     httpClient = std::make_unique<http::HttpClient>();
 #endif
+#ifdef CONFIG_EXT_CON_OTA_ENABLE
+    // Until the PPP link got an IP address or the first LoRa uplink was sent, a reset
+    // makes the bootloader roll back to the last image
+    ota::OtaUpdater::confirmOnConnectivity();
+#endif
+#ifdef CONFIG_EXT_CON_MQTT_ENABLE
+    mqtt::MqttClient::start();
+#endif
 #ifdef CONFIG_EXT_CON_LORA_ENABLE
     loraService = std::make_unique<lora::LoraService>(CONFIG_EXT_CON_LORA_APP_EUI,
                                                       CONFIG_EXT_CON_LORA_APP_KEY,
@@ -43,9 +65,11 @@ extern "C" void app_main(void) {
         return;
     }
 
-    const bool launchAsTask{false};
+    // The console takes over this task, so the LoRa loop needs its own
 #ifdef CONFIG_EXT_CON_REPL_ENABLE
-    launchAsTask = true;
+    constexpr bool launchAsTask{true};
+#else
+    constexpr bool launchAsTask{false};
 #endif
     loraService->start(launchAsTask);
 #endif